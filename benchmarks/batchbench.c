@@ -0,0 +1,157 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Primitives per second drawn one call each and by array calls
+ * (putpixels, drawlines, bars, circles, fillellipses). Primitives are
+ * drawn on visual page like samples/particles.c and samples/lotsofbars.c
+ * do, so every call pays for its own damage and present, array call pays
+ * once. Arrays are filled before timing.
+ */
+
+#include "bench.h"
+#include <graphics.h>
+#include <stdlib.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define COUNT 20000
+#define FRAMES 20
+
+enum { PIXELS, LINES, BARS, CIRCLES, FILLELLIPSES, KINDS };
+
+static const int fields[KINDS] = {3, 5, 5, 4, 5};
+static int records[COUNT * 5];
+
+/* Particle-sized circles and ellipses, bars and lines up to 64 pixels */
+static void fillRecords(int kind)
+{
+  int i, * r = records;
+  srand(kind);
+  for(i = 0; i != COUNT; i++, r += fields[kind])
+  {
+    r[0] = rand() % WIDTH;
+    r[1] = rand() % HEIGHT;
+    if(kind == LINES || kind == BARS)
+    {
+      r[2] = r[0] + rand() % 64 - 32;
+      r[3] = r[1] + rand() % 64 - 32;
+    }
+    else if(kind == CIRCLES)
+      r[2] = i % 8 + 1;
+    else if(kind == FILLELLIPSES)
+      r[2] = r[3] = i % 8 + 1;
+    r[fields[kind] - 1] = i % getmaxcolor() + 1;
+  }
+}
+
+static void drawOneByOne(int kind)
+{
+  int i, * r = records;
+  for(i = 0; i != COUNT; i++, r += fields[kind])
+  {
+    switch(kind)
+    {
+    case PIXELS:
+      putpixel(r[0], r[1], r[2]);
+      break;
+    case LINES:
+      setcolor(r[4]);
+      line(r[0], r[1], r[2], r[3]);
+      break;
+    case BARS:
+      setfillstyle(SOLID_FILL, r[4]);
+      bar(r[0], r[1], r[2], r[3]);
+      break;
+    case CIRCLES:
+      setcolor(r[3]);
+      circle(r[0], r[1], r[2]);
+      break;
+    default:
+      setfillstyle(SOLID_FILL, r[4]);
+      fillellipse(r[0], r[1], r[2], r[3]);
+    }
+  }
+}
+
+static void drawArray(int kind)
+{
+  switch(kind)
+  {
+  case PIXELS:
+    putpixels(COUNT, records);
+    break;
+  case LINES:
+    drawlines(COUNT, records);
+    break;
+  case BARS:
+    bars(COUNT, records);
+    break;
+  case CIRCLES:
+    circles(COUNT, records);
+    break;
+  default:
+    fillellipses(COUNT, records);
+  }
+}
+
+/* Returns primitives per second */
+static double frames(int kind, int array)
+{
+  int frame;
+  double start;
+  fillRecords(kind);
+  setfillstyle(SOLID_FILL, getmaxcolor());
+  start = BENCH_now();
+  for(frame = 0; frame != FRAMES; frame++)
+  {
+    if(array)
+      drawArray(kind);
+    else
+      drawOneByOne(kind);
+  }
+  getpixel(0, 0);
+  return (double)FRAMES * COUNT / (BENCH_now() - start);
+}
+
+static void run(const char * name, const char * options)
+{
+  static const char * kinds[KINDS] = {"pixels", "lines", "bars", "circles", "filled ellipses"};
+  int gd = CUSTOM, gm = CUSTOM_MODE(WIDTH, HEIGHT), kind, array;
+  char title[64];
+  initgraph(&gd, &gm, options);
+  for(kind = PIXELS; kind != KINDS; kind++)
+  {
+    for(array = 0; array != 2; array++)
+    {
+      sprintf(title, "%s %s%s", name, kinds[kind], array ? ", array" : "");
+      BENCH_report(title, frames(kind, array) / 1e3, "K/s");
+    }
+  }
+  closegraph();
+}
+
+int main(void)
+{
+  /* windowed on Win32, headless elsewhere */
+  run("16 colors", "");
+  run("RGB", "RGB");
+  run("16 colors, pipeline", "PIPELINE");
+  return 0;
+}
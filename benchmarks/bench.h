@@ -0,0 +1,57 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+/**
+ * Helpers shared by benchmarks: precise timer and uniform output
+ * (one measurement per line: name, value, unit)
+ */
+
+#include <stdio.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
+/* Returns time in seconds from some unspecified point */
+static double BENCH_now(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER counter, frequency;
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&frequency);
+  return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+static void BENCH_report(const char * name, double value, const char * unit)
+{
+  printf("%-40s %14.3f %s\n", name, value, unit);
+  fflush(stdout);
+}
+
+#endif
@@ -0,0 +1,109 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Image throughput of rasterizer on plain memory: full screen images
+ * and 64x64 and 16x16 sprites at random places (partly outside screen)
+ * put by every operation of putimage, with every blit kernel CPU
+ * supports, and full screen getimage, on 4bpp and 32bpp surfaces.
+ * Throughput is image pixels per second.
+ */
+
+#include "bench.h"
+#include <Raster.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+/* Pixels to put in every measurement */
+#define VOLUME 2e8
+
+static const char * kernelNames[] = {"C", "SSE2", "AVX2"};
+static const char * opNames[] = {"COPY", "XOR", "OR", "AND", "NOT"};
+
+static unsigned image[WIDTH * HEIGHT];
+
+/* Returns pixels per second, images are size x size (0 is full screen) */
+static double put(RASTER_CONTEXT * ctx, int size, int op)
+{
+  int i, count, x, y, width = size ? size : WIDTH, height = size ? size : HEIGHT;
+  double pixels = (double)width * height, start;
+  count = (int)(VOLUME / pixels);
+  srand(1);
+  start = BENCH_now();
+  for(i = 0; i != count; i++)
+  {
+    x = size ? rand() % (WIDTH + size) - size : 0;
+    y = size ? rand() % (HEIGHT + size) - size : 0;
+    RASTER_putImage(ctx, x, y, width, height, image, op);
+  }
+  return count * pixels / (BENCH_now() - start);
+}
+
+static double get(RASTER_CONTEXT * ctx)
+{
+  int i, count = (int)(VOLUME / (WIDTH * HEIGHT));
+  double start = BENCH_now();
+  for(i = 0; i != count; i++)
+    RASTER_getImage(ctx, 0, 0, WIDTH, HEIGHT, image);
+  return (double)count * WIDTH * HEIGHT / (BENCH_now() - start);
+}
+
+static void run(int bpp)
+{
+  static const int sizes[] = {0, 64, 16};
+  int kernel, i, op;
+  char title[64];
+  RASTER_CONTEXT ctx;
+  RASTER_SCRATCH scratch = {NULL, 0};
+  void * bits = calloc(RASTER_stride(WIDTH, bpp) * HEIGHT, 1);
+  memset(&ctx, 0, sizeof(ctx));
+  RASTER_initSurface(&ctx.surface, bits, WIDTH, HEIGHT, bpp);
+  ctx.clipRight = WIDTH - 1;
+  ctx.clipBottom = HEIGHT - 1;
+  ctx.scratch = &scratch;
+  for(i = 0; i != WIDTH * HEIGHT; i++)
+    image[i] = bpp == 32 ? (unsigned)i * 2654435761u >> 8 : i % 16;
+  for(kernel = SPAN_C; kernel <= SPAN_AVX2; kernel++)
+  {
+    if(!SPAN_setKernel(kernel))
+      continue;
+    for(i = 0; i != sizeof(sizes) / sizeof(sizes[0]); i++)
+      for(op = RASTER_COPY; op <= RASTER_NOT; op++)
+      {
+        if(sizes[i])
+          sprintf(title, "%dbpp %s %dx%d %s", bpp, kernelNames[kernel], sizes[i], sizes[i], opNames[op]);
+        else
+          sprintf(title, "%dbpp %s screen %s", bpp, kernelNames[kernel], opNames[op]);
+        BENCH_report(title, put(&ctx, sizes[i], op) / 1e6, "Mpixels/s");
+      }
+  }
+  sprintf(title, "%dbpp getimage screen", bpp);
+  BENCH_report(title, get(&ctx) / 1e6, "Mpixels/s");
+  RASTER_freeScratch(&scratch);
+  free(bits);
+}
+
+int main(void)
+{
+  run(4);
+  run(32);
+  return 0;
+}
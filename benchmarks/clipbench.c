@@ -0,0 +1,152 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Clip stage of software rasterizer: same primitives (lines, ellipses,
+ * filled ellipses, bars, polygons) are drawn fully inside viewport,
+ * across its edges and fully outside it. Outside objects should cost
+ * almost nothing, inside ones go without per pixel checks.
+ */
+
+#include "bench.h"
+#include <Raster.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+/* viewport in the middle of surface */
+#define VIEW_LEFT 160
+#define VIEW_TOP 120
+#define VIEW_WIDTH 320
+#define VIEW_HEIGHT 240
+#define OBJECTS 100000
+#define POINTS 1024
+#define SIZE 40
+
+/* Where generated objects are */
+enum { INSIDE, CROSSING, OUTSIDE };
+/* Drawn primitives */
+enum { LINES, ELLIPSES, FILLED, BARS, POLYGONS, PRIMITIVES };
+
+/* Centers of objects in viewport coordinates */
+static int centers[POINTS][2];
+
+static void generate(int where)
+{
+  int i, x, y;
+  srand(1);
+  for(i = 0; i != POINTS; i++)
+  {
+    x = rand() % (VIEW_WIDTH - 2 * SIZE) + SIZE;
+    y = rand() % (VIEW_HEIGHT - 2 * SIZE) + SIZE;
+    if(where == CROSSING)
+    {
+      /* center is on left or right edge */
+      x = (i & 1) ? VIEW_WIDTH - 1 : 0;
+    }
+    else if(where == OUTSIDE)
+    {
+      /* far enough from viewport, but on surface */
+      x = (i & 1) ? VIEW_WIDTH + SIZE + rand() % SIZE : -SIZE - rand() % SIZE - 1;
+    }
+    centers[i][0] = x;
+    centers[i][1] = y;
+  }
+}
+
+static void draw(const RASTER_CONTEXT * ctx, int primitive, int x, int y)
+{
+  int polygon[8];
+  switch(primitive)
+  {
+  case LINES:
+    RASTER_line(ctx, x - SIZE, y - SIZE / 2, x + SIZE, y + SIZE / 2);
+    break;
+  case ELLIPSES:
+    RASTER_ellipse(ctx, x, y, 0, 360, SIZE, SIZE / 2);
+    break;
+  case FILLED:
+    RASTER_fillEllipse(ctx, x, y, SIZE, SIZE / 2);
+    break;
+  case BARS:
+    RASTER_bar(ctx, x - SIZE, y - SIZE / 2, x + SIZE, y + SIZE / 2);
+    break;
+  default:
+    polygon[0] = x - SIZE;
+    polygon[1] = y;
+    polygon[2] = x;
+    polygon[3] = y - SIZE / 2;
+    polygon[4] = x + SIZE;
+    polygon[5] = y;
+    polygon[6] = x;
+    polygon[7] = y + SIZE / 2;
+    RASTER_fillPoly(ctx, 4, polygon);
+  }
+}
+
+/* Returns objects per second */
+static double objects(const RASTER_CONTEXT * ctx, int primitive)
+{
+  int i;
+  double start = BENCH_now();
+  for(i = 0; i != OBJECTS; i++)
+    draw(ctx, primitive, centers[i % POINTS][0], centers[i % POINTS][1]);
+  return OBJECTS / (BENCH_now() - start);
+}
+
+static void run(int bpp)
+{
+  static const char * places[] = { "inside", "crossing", "outside" };
+  static const char * primitives[PRIMITIVES] = { "lines", "ellipses", "filled ellipses", "bars", "polygons" };
+  int where, primitive;
+  char title[64];
+  RASTER_CONTEXT ctx;
+  void * bits = malloc(RASTER_stride(WIDTH, bpp) * HEIGHT);
+  memset(&ctx, 0, sizeof(ctx));
+  RASTER_initSurface(&ctx.surface, bits, WIDTH, HEIGHT, bpp);
+  ctx.clipLeft = VIEW_LEFT;
+  ctx.clipTop = VIEW_TOP;
+  ctx.clipRight = VIEW_LEFT + VIEW_WIDTH - 1;
+  ctx.clipBottom = VIEW_TOP + VIEW_HEIGHT - 1;
+  ctx.originX = VIEW_LEFT;
+  ctx.originY = VIEW_TOP;
+  ctx.color = ctx.fillColor = bpp == 32 ? 0xFFFF00 : 14;
+  ctx.linePattern = RASTER_SOLID_LINE;
+  ctx.lineWidth = 1;
+  memset(ctx.fillPattern, 0xFF, sizeof(ctx.fillPattern));
+  RASTER_expandFill(&ctx);
+  for(where = INSIDE; where <= OUTSIDE; where++)
+  {
+    generate(where);
+    for(primitive = 0; primitive != PRIMITIVES; primitive++)
+    {
+      sprintf(title, "%dbpp %s %s", bpp, places[where], primitives[primitive]);
+      BENCH_report(title, objects(&ctx, primitive) / 1e3, "Kobjects/s");
+    }
+  }
+  free(bits);
+}
+
+int main(void)
+{
+  run(4);
+  run(32);
+  return 0;
+}
@@ -0,0 +1,160 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Workloads of samples/putpixeltest.c and samples/xorlines.c scaled
+ * up: whole visual page is filled by putpixel and by writes to page
+ * memory given by lockpage, then lots of XOR lines
+ * (with all line styles) are drawn and erased, then particle-sized
+ * circles and filled ellipses are drawn. Everything is drawn on
+ * visual page, where primitives used to be drawn twice (into page and
+ * into window), now they are drawn once and window is updated by
+ * presents of damaged rectangles.
+ */
+
+#include "bench.h"
+#include <graphics.h>
+#include <stdlib.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define PIXEL_PASSES 4
+#define LINES 20000
+#define CIRCLES 200000
+
+/* Returns pixels per second */
+static double plainPixels(void)
+{
+  int x, y, pass;
+  double start = BENCH_now();
+  for(pass = 0; pass != PIXEL_PASSES; pass++)
+    for(y = 0; y != HEIGHT; y++)
+      for(x = 0; x != WIDTH; x++)
+        putpixel(x, y, (x ^ y ^ pass) % getmaxcolor() + 1);
+  /* make sure everything is on the page */
+  getpixel(0, 0);
+  return (double)PIXEL_PASSES * WIDTH * HEIGHT / (BENCH_now() - start);
+}
+
+/* Same pixels as plainPixels writes, returns pixels per second */
+static double lockedPixels(void)
+{
+  int x, y, pass, color;
+  unsigned char * row;
+  g_pagedesctype page;
+  double start = BENCH_now();
+  for(pass = 0; pass != PIXEL_PASSES; pass++)
+  {
+    lockpage(0, &page);
+    for(y = 0; y != HEIGHT; y++)
+    {
+      row = page.rows[y];
+      for(x = 0; x != WIDTH; x++)
+      {
+        color = (x ^ y ^ pass) % getmaxcolor() + 1;
+        if(page.format == PIXELFORMAT_32BPP)
+          ((unsigned *)row)[x] = color;
+        else if(page.format == PIXELFORMAT_8BPP)
+          row[x] = (unsigned char)color;
+        else if(x & 1)
+          row[x >> 1] = (unsigned char)((row[x >> 1] & 0xF0) | color);
+        else
+          row[x >> 1] = (unsigned char)((row[x >> 1] & 0x0F) | (color << 4));
+      }
+    }
+    unlockpage(0, NULL);
+  }
+  return (double)PIXEL_PASSES * WIDTH * HEIGHT / (BENCH_now() - start);
+}
+
+/* Returns lines per second, every line is drawn twice: XOR puts and erases it */
+static double xorlines(void)
+{
+  int i, x1, y1, x2, y2;
+  double start;
+  srand(1);
+  setwritemode(XOR_PUT);
+  start = BENCH_now();
+  for(i = 0; i != LINES; i++)
+  {
+    x1 = rand() % WIDTH;
+    y1 = rand() % HEIGHT;
+    x2 = rand() % WIDTH;
+    y2 = rand() % HEIGHT;
+    setcolor(i % getmaxcolor() + 1);
+    setlinestyle(i % USERBIT_LINE, 0, (i & 1) ? THICK_WIDTH : NORM_WIDTH);
+    line(x1, y1, x2, y2);
+    line(x1, y1, x2, y2);
+  }
+  getpixel(0, 0);
+  setwritemode(COPY_PUT);
+  setlinestyle(SOLID_LINE, 0, NORM_WIDTH);
+  return 2 * LINES / (BENCH_now() - start);
+}
+
+/* Returns circles per second, radii are from 1 to 8 like ones of samples/particles.c */
+static double circleShapes(int filled)
+{
+  int i, x, y, r;
+  double start;
+  srand(1);
+  setfillstyle(SOLID_FILL, getmaxcolor());
+  start = BENCH_now();
+  for(i = 0; i != CIRCLES; i++)
+  {
+    x = rand() % WIDTH;
+    y = rand() % HEIGHT;
+    r = i % 8 + 1;
+    setcolor(i % getmaxcolor() + 1);
+    if(filled)
+      fillellipse(x, y, r, r);
+    else
+      circle(x, y, r);
+  }
+  getpixel(0, 0);
+  return CIRCLES / (BENCH_now() - start);
+}
+
+static void run(const char * name, const char * options)
+{
+  int gd = CUSTOM, gm = CUSTOM_MODE(WIDTH, HEIGHT);
+  char title[64];
+  initgraph(&gd, &gm, options);
+  sprintf(title, "%s putpixel", name);
+  BENCH_report(title, plainPixels() / 1e6, "Mpixels/s");
+  sprintf(title, "%s locked page pixels", name);
+  BENCH_report(title, lockedPixels() / 1e6, "Mpixels/s");
+  sprintf(title, "%s XOR lines", name);
+  BENCH_report(title, xorlines() / 1e3, "Klines/s");
+  sprintf(title, "%s circles", name);
+  BENCH_report(title, circleShapes(0) / 1e3, "Kcircles/s");
+  sprintf(title, "%s filled ellipses", name);
+  BENCH_report(title, circleShapes(1) / 1e3, "Kellipses/s");
+  closegraph();
+}
+
+int main(void)
+{
+  /* windowed on Win32, headless elsewhere */
+  run("16 colors", "");
+  run("RGB", "RGB");
+  run("256 colors", "COLORS256");
+  run("16 colors, pipeline", "PIPELINE");
+  return 0;
+}
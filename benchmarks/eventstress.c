@@ -0,0 +1,145 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Stress test of input event queue: a thread that stands in for server
+ * window procedure pushes 100000 events per second to the queue of
+ * headless graphics, main thread drains it with getevent() and checks
+ * that every event arrived once and in order.
+ */
+
+#include "bench.h"
+#include <graphics.h>
+#include <BGI.H>
+#include <stdlib.h>
+#ifndef _WIN32
+  #include <pthread.h>
+#endif
+
+#define EVENTS_PER_SECOND 100000
+#define SECONDS 3
+#define TOTAL_EVENTS (EVENTS_PER_SECOND * SECONDS)
+/* events are pushed in batches every millisecond */
+#define BATCH (EVENTS_PER_SECOND / 1000)
+
+static volatile int producerDone = 0;
+
+static void producer(void)
+{
+  BGI_EVENT_QUEUE * queue = &BGI_getSharedStruct()->events;
+  BGI_EVENT event;
+  double start = BENCH_now();
+  int sent = 0, i;
+  while(sent != TOTAL_EVENTS)
+  {
+    /* wait until it is time for next batch */
+    while(BENCH_now() - start < (double)sent / EVENTS_PER_SECOND)
+      delay(1);
+    for(i = 0; i != BATCH; i++, sent++)
+    {
+      event.type = sent % 2 ? BGI_EVENT_MOUSEMOVE : BGI_EVENT_KEY;
+      event.time = (unsigned)sent;
+      event.key = 0;
+      event.letter = 'a' + sent % 26;
+      event.x = sent;
+      event.y = 0;
+      event.buttons = 0;
+      BGI_pushEvent(queue, &event);
+    }
+  }
+  producerDone = 1;
+}
+
+#ifdef _WIN32
+
+static DWORD WINAPI producerThread(LPVOID param)
+{
+  producer();
+  return 0;
+}
+
+#else
+
+static void * producerThread(void * param)
+{
+  producer();
+  return NULL;
+}
+
+#endif
+
+int main(void)
+{
+  int gd = DETECT, gm;
+  int received = 0, expected = 0, outOfOrder = 0, depth, maxDepth = 0;
+  BGI_EVENT_QUEUE * queue;
+  g_event event;
+  double start, time;
+#ifdef _WIN32
+  HANDLE thread;
+#else
+  pthread_t thread;
+#endif
+
+  initgraph(&gd, &gm, "HEADLESS");
+  queue = &BGI_getSharedStruct()->events;
+
+  start = BENCH_now();
+#ifdef _WIN32
+  thread = CreateThread(NULL, 0, producerThread, NULL, 0, NULL);
+#else
+  pthread_create(&thread, NULL, producerThread, NULL);
+#endif
+  while(!producerDone || anykeypressed() || queue->head != queue->tail)
+  {
+    depth = (int)(queue->head - queue->tail);
+    if(depth > maxDepth)
+      maxDepth = depth;
+    while(getevent(&event))
+    {
+      if(event.x != expected || event.letter != 'a' + event.x % 26)
+        outOfOrder++;
+      expected = event.x + 1;
+      received++;
+    }
+    /* queue is empty, give time to producer */
+    delay(0);
+  }
+  time = BENCH_now() - start;
+#ifdef _WIN32
+  WaitForSingleObject(thread, INFINITE);
+#else
+  pthread_join(thread, NULL);
+#endif
+
+  BENCH_report("events received", received, "");
+  BENCH_report("events per second", received / time, "1/s");
+  BENCH_report("events dropped", queue->dropped, "");
+  BENCH_report("events out of order", outOfOrder, "");
+  BENCH_report("max queue depth", maxDepth, "");
+  closegraph();
+
+  if(received != TOTAL_EVENTS || queue->dropped != 0 || outOfOrder != 0)
+  {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,129 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Fill throughput of rasterizer on plain memory: full screen clears
+ * (cleardevice), full screen and small bars with solid and hatched
+ * patterns, on 4bpp, 8bpp and 32bpp surfaces, with every span kernel
+ * CPU supports, and expansion of 8bpp frames by palette that is done
+ * when they are presented. Throughput is bytes of surface written per
+ * second (bytes of 32bpp frame for expansion).
+ */
+
+#include "bench.h"
+#include <Raster.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+/* Bytes to write in every measurement */
+#define VOLUME 5e8
+
+static const char * kernelNames[] = {"C", "SSE2", "AVX2"};
+
+/* Returns bytes per second, rectangles are size x size (0 is full screen) */
+static double fill(RASTER_CONTEXT * ctx, int size, int clear)
+{
+  int i, count, x, y, width = size ? size : WIDTH, height = size ? size : HEIGHT;
+  double bytes = (double)width * height * ctx->surface.bpp / 8, start;
+  count = (int)(VOLUME / bytes);
+  srand(1);
+  start = BENCH_now();
+  for(i = 0; i != count; i++)
+  {
+    /* small rectangles start at any pixel */
+    x = size ? rand() % (WIDTH - size) : 0;
+    y = size ? rand() % (HEIGHT - size) : 0;
+    if(clear)
+      RASTER_clear(ctx, x, y, x + width - 1, y + height - 1, ctx->fillColor);
+    else
+      RASTER_bar(ctx, x, y, x + width - 1, y + height - 1);
+  }
+  return count * bytes / (BENCH_now() - start);
+}
+
+/* Expands whole 8bpp frame to 32bpp by palette, returns bytes written per second */
+static double expand(const unsigned char * bits)
+{
+  int i, y, count, stride = RASTER_stride(WIDTH, 8);
+  double bytes = (double)WIDTH * HEIGHT * 4, start;
+  unsigned table[256];
+  unsigned * frame = malloc(WIDTH * HEIGHT * 4);
+  for(i = 0; i != 256; i++)
+    table[i] = (unsigned)i * 0x010101;
+  count = (int)(VOLUME / bytes);
+  start = BENCH_now();
+  for(i = 0; i != count; i++)
+    for(y = 0; y != HEIGHT; y++)
+      SPAN_expand(frame + y * WIDTH, bits + y * stride, WIDTH, table);
+  start = BENCH_now() - start;
+  free(frame);
+  return count * bytes / start;
+}
+
+static void run(int bpp)
+{
+  static const struct { const char * name; int size, clear; unsigned char pattern; } cases[] =
+  {
+    { "clear", 0, 1, 0xFF },
+    { "solid bar", 0, 0, 0xFF },
+    { "hatched bar", 0, 0, 0x55 },
+    { "solid 64x64 bars", 64, 0, 0xFF },
+    { "hatched 64x64 bars", 64, 0, 0x55 },
+    { "solid 8x8 bars", 8, 0, 0xFF },
+    { "hatched 8x8 bars", 8, 0, 0x55 }
+  };
+  int kernel, i;
+  char title[64];
+  RASTER_CONTEXT ctx;
+  void * bits = malloc(RASTER_stride(WIDTH, bpp) * HEIGHT);
+  memset(&ctx, 0, sizeof(ctx));
+  RASTER_initSurface(&ctx.surface, bits, WIDTH, HEIGHT, bpp);
+  ctx.clipRight = WIDTH - 1;
+  ctx.clipBottom = HEIGHT - 1;
+  ctx.fillColor = bpp == 32 ? 0xFFFF00 : 14;
+  ctx.backColor = bpp == 32 ? 0x0000FF : 1;
+  for(kernel = SPAN_C; kernel <= SPAN_AVX2; kernel++)
+  {
+    if(!SPAN_setKernel(kernel))
+      continue;
+    for(i = 0; i != sizeof(cases) / sizeof(cases[0]); i++)
+    {
+      memset(ctx.fillPattern, cases[i].pattern, sizeof(ctx.fillPattern));
+      RASTER_expandFill(&ctx);
+      sprintf(title, "%dbpp %s %s", bpp, kernelNames[kernel], cases[i].name);
+      BENCH_report(title, fill(&ctx, cases[i].size, cases[i].clear) / 1e9, "GB/s");
+    }
+    if(bpp == 8)
+    {
+      sprintf(title, "8bpp %s palette expansion", kernelNames[kernel]);
+      BENCH_report(title, expand(bits) / 1e9, "GB/s");
+    }
+  }
+  free(bits);
+}
+
+int main(void)
+{
+  run(4);
+  run(8);
+  run(32);
+  return 0;
+}
@@ -0,0 +1,151 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Filled pixels per second of flood fill on plain 4bpp and 32bpp
+ * memory: empty screen (long spans only), full-screen maze of one pixel
+ * wide corridors (lots of short spans and branches) and square spiral
+ * (one corridor that turns all the time). Fills alternate two colors, so the same area is filled
+ * every time and nothing has to be redrawn.
+ */
+
+#include "bench.h"
+#include <Raster.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define WALL 1
+/* Every measurement lasts at least that long (seconds) */
+#define DURATION 0.5
+
+enum { EMPTY, MAZE, SPIRAL };
+
+/* Maze cells are at odd coordinates, walls between them are removed by random depth-first walk */
+static void maze(RASTER_CONTEXT * ctx)
+{
+  static const int dx[] = {2, -2, 0, 0}, dy[] = {0, 0, 2, -2};
+  int cellsX = (WIDTH - 1) / 2, cellsY = (HEIGHT - 1) / 2;
+  int * stack = malloc(cellsX * cellsY * sizeof(int));
+  char * visited = calloc(cellsX * cellsY, 1);
+  int count = 0, x, y, nx, ny, d, tries, cell;
+  srand(1);
+  RASTER_clear(ctx, 0, 0, WIDTH - 1, HEIGHT - 1, WALL);
+  stack[count++] = 0;
+  visited[0] = 1;
+  RASTER_putPixel(ctx, 1, 1, 0, RASTER_COPY);
+  while(count != 0)
+  {
+    cell = stack[count - 1];
+    x = cell % cellsX * 2 + 1;
+    y = cell / cellsX * 2 + 1;
+    for(tries = 0, d = rand() % 4; tries != 4; tries++, d = (d + 1) % 4)
+    {
+      nx = x + dx[d];
+      ny = y + dy[d];
+      if(nx > 0 && ny > 0 && nx < cellsX * 2 && ny < cellsY * 2 && !visited[ny / 2 * cellsX + nx / 2])
+        break;
+    }
+    if(tries == 4)
+    {
+      count--;
+      continue;
+    }
+    visited[ny / 2 * cellsX + nx / 2] = 1;
+    RASTER_putPixel(ctx, (x + nx) / 2, (y + ny) / 2, 0, RASTER_COPY);
+    RASTER_putPixel(ctx, nx, ny, 0, RASTER_COPY);
+    stack[count++] = ny / 2 * cellsX + nx / 2;
+  }
+  free(stack);
+  free(visited);
+}
+
+/* Walls of square spiral go inwards, corridor between them is one pixel wide */
+static void spiral(RASTER_CONTEXT * ctx)
+{
+  int left = 0, top = 0, right = WIDTH - 1, bottom = HEIGHT - 1;
+  RASTER_clear(ctx, 0, 0, WIDTH - 1, HEIGHT - 1, 0);
+  ctx->color = WALL;
+  while(right - left > 4 && bottom - top > 4)
+  {
+    RASTER_line(ctx, left, top, right, top);
+    RASTER_line(ctx, right, top, right, bottom);
+    RASTER_line(ctx, right, bottom, left, bottom);
+    RASTER_line(ctx, left, bottom, left, top + 2);
+    RASTER_line(ctx, left, top + 2, left + 2, top + 2);
+    left += 2;
+    top += 2;
+    right -= 2;
+    bottom -= 2;
+  }
+}
+
+/* Returns filled pixels per second */
+static double flood(RASTER_CONTEXT * ctx, int x, int y)
+{
+  int fills = 0, pixels = 0, i, j;
+  double start = BENCH_now(), elapsed;
+  do
+  {
+    ctx->fillColor = fills & 1 ? 2 : 3;
+    RASTER_expandFill(ctx);
+    RASTER_floodFill(ctx, x, y, WALL);
+    fills++;
+    elapsed = BENCH_now() - start;
+  }
+  while(elapsed < DURATION);
+  for(j = 0; j != HEIGHT; j++)
+    for(i = 0; i != WIDTH; i++)
+      pixels += RASTER_getPixel(ctx, i, j) != WALL;
+  return (double)pixels * fills / elapsed;
+}
+
+int main(void)
+{
+  static const char * scenes[] = {"empty", "maze", "spiral"};
+  int scene, bpp;
+  char title[64];
+  RASTER_CONTEXT ctx;
+  RASTER_SCRATCH scratch = {NULL, 0};
+  void * bits = malloc(RASTER_stride(WIDTH, 32) * HEIGHT);
+  for(bpp = 4; bpp <= 32; bpp += 28)
+    for(scene = EMPTY; scene <= SPIRAL; scene++)
+    {
+      memset(&ctx, 0, sizeof(ctx));
+      RASTER_initSurface(&ctx.surface, bits, WIDTH, HEIGHT, bpp);
+      ctx.clipRight = WIDTH - 1;
+      ctx.clipBottom = HEIGHT - 1;
+      ctx.linePattern = RASTER_SOLID_LINE;
+      ctx.lineWidth = 1;
+      memset(ctx.fillPattern, 0xFF, sizeof(ctx.fillPattern));
+      ctx.scratch = &scratch;
+      if(scene == EMPTY)
+        RASTER_clear(&ctx, 0, 0, WIDTH - 1, HEIGHT - 1, 0);
+      else if(scene == MAZE)
+        maze(&ctx);
+      else
+        spiral(&ctx);
+      sprintf(title, "%dbpp %s", bpp, scenes[scene]);
+      BENCH_report(title, flood(&ctx, 1, 1) / 1e6, "Mpixels/s");
+    }
+  RASTER_freeScratch(&scratch);
+  free(bits);
+  return 0;
+}
@@ -0,0 +1,153 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Full frame redraw rates of "RGB" (32bpp) and "HICOLOR" (16bpp RGB565)
+ * pages at 1024x768 with double buffering. Every frame clears back page,
+ * covers it with bands of bars and draws filled ellipses over them, then
+ * flips pages. First the rasterizer draws into plain memory with every
+ * span kernel CPU supports (16bpp frames are measured with and without
+ * expansion to 32bpp that is done when they are presented), then the
+ * same frames are drawn through graphics.h (windowed on Win32, where
+ * presents are counted too, headless elsewhere).
+ */
+
+#include "bench.h"
+#include <Raster.h>
+#include <graphics.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 1024
+#define HEIGHT 768
+#define BANDS 48
+#define ELLIPSES 64
+/* Frames of every measurement */
+#define FRAMES 300
+
+static const char * kernelNames[] = {"C", "SSE2", "AVX2"};
+
+/* Pixel of surface of bpp bits for 8-bit components */
+static unsigned pixelOf(int bpp, int r, int g, int b)
+{
+  if(bpp == 16)
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | ((b & 0xF8) >> 3);
+  return (r << 16) | (g << 8) | b;
+}
+
+/* Draws one frame by rasterizer */
+static void drawFrame(RASTER_CONTEXT * ctx, int frame)
+{
+  int i, bpp = ctx->surface.bpp;
+  RASTER_clear(ctx, 0, 0, WIDTH - 1, HEIGHT - 1, 0);
+  for(i = 0; i != BANDS; i++)
+  {
+    ctx->fillColor = pixelOf(bpp, i * 5, (i + frame) * 3 & 0xFF, 255 - i * 5);
+    RASTER_expandFill(ctx);
+    RASTER_bar(ctx, 0, i * HEIGHT / BANDS, WIDTH - 1, (i + 1) * HEIGHT / BANDS - 1);
+  }
+  for(i = 0; i != ELLIPSES; i++)
+  {
+    ctx->fillColor = pixelOf(bpp, 255, i * 4, 0);
+    RASTER_expandFill(ctx);
+    RASTER_fillEllipse(ctx, (i * 97 + frame * 4) % WIDTH, i * 61 % HEIGHT, 40, 30);
+  }
+}
+
+/* Returns frames per second, present is set if 16bpp frames are expanded to 32bpp like presents do */
+static double rasterFrames(int bpp, int present)
+{
+  int frame, y, stride = RASTER_stride(WIDTH, bpp);
+  double start;
+  RASTER_CONTEXT ctx;
+  void * pages[2];
+  unsigned * expanded = malloc(WIDTH * HEIGHT * 4);
+  pages[0] = malloc(stride * HEIGHT);
+  pages[1] = malloc(stride * HEIGHT);
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.clipRight = WIDTH - 1;
+  ctx.clipBottom = HEIGHT - 1;
+  memset(ctx.fillPattern, 0xFF, sizeof(ctx.fillPattern));
+  start = BENCH_now();
+  for(frame = 0; frame != FRAMES; frame++)
+  {
+    RASTER_initSurface(&ctx.surface, pages[frame & 1], WIDTH, HEIGHT, bpp);
+    drawFrame(&ctx, frame);
+    if(present)
+      for(y = 0; y != HEIGHT; y++)
+        SPAN_expand565(expanded + y * WIDTH, (const unsigned short *)((unsigned char *)pages[frame & 1] + y * stride), WIDTH);
+  }
+  start = BENCH_now() - start;
+  free(pages[0]);
+  free(pages[1]);
+  free(expanded);
+  return FRAMES / start;
+}
+
+/* Returns frames per second of frames drawn through graphics.h */
+static double graphicsFrames(const char * options)
+{
+  int gd = CUSTOM, gm = CUSTOM_MODE(WIDTH, HEIGHT), frame, i;
+  double start;
+  initgraph(&gd, &gm, options);
+  start = BENCH_now();
+  for(frame = 0; frame != FRAMES; frame++)
+  {
+    setactivepage(frame & 1);
+    cleardevice();
+    for(i = 0; i != BANDS; i++)
+    {
+      setfillstyle(SOLID_FILL, rgb(i * 5, (i + frame) * 3 & 0xFF, 255 - i * 5));
+      bar(0, i * HEIGHT / BANDS, WIDTH, (i + 1) * HEIGHT / BANDS);
+    }
+    for(i = 0; i != ELLIPSES; i++)
+    {
+      setfillstyle(SOLID_FILL, rgb(255, i * 4, 0));
+      fillellipse((i * 97 + frame * 4) % WIDTH, i * 61 % HEIGHT, 40, 30);
+    }
+    setvisualpage(frame & 1);
+  }
+  /* last frame must be drawn */
+  getpixel(0, 0);
+  start = BENCH_now() - start;
+  closegraph();
+  return FRAMES / start;
+}
+
+int main(void)
+{
+  int kernel;
+  char title[64];
+  for(kernel = SPAN_C; kernel <= SPAN_AVX2; kernel++)
+  {
+    if(!SPAN_setKernel(kernel))
+      continue;
+    sprintf(title, "32bpp %s frames", kernelNames[kernel]);
+    BENCH_report(title, rasterFrames(32, 0), "frames/s");
+    sprintf(title, "16bpp %s frames", kernelNames[kernel]);
+    BENCH_report(title, rasterFrames(16, 0), "frames/s");
+    sprintf(title, "16bpp %s frames with expansion", kernelNames[kernel]);
+    BENCH_report(title, rasterFrames(16, 1), "frames/s");
+  }
+  BENCH_report("RGB frames", graphicsFrames("RGB"), "frames/s");
+  BENCH_report("HICOLOR frames", graphicsFrames("HICOLOR"), "frames/s");
+  BENCH_report("RGB pipeline frames", graphicsFrames("RGB PIPELINE"), "frames/s");
+  BENCH_report("HICOLOR pipeline frames", graphicsFrames("HICOLOR PIPELINE"), "frames/s");
+  return 0;
+}
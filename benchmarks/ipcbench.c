@@ -0,0 +1,172 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Measures IPC layer between two processes:
+ *  - event round trip latency (client raises one event, server answers
+ *    with another one, as readkey/WM_KEYPROCESSED does)
+ *  - throughput of 640x480x32bpp page shared by section: one process
+ *    writes whole page, other reads it.
+ */
+
+#include "bench.h"
+#include <IPC.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+  #include <unistd.h>
+  #include <sys/wait.h>
+#endif
+
+#define PING_EVENT_NAME "BGI_BenchPing"
+#define PONG_EVENT_NAME "BGI_BenchPong"
+#define PAGE_SECTION_NAME "BGI_BenchPage"
+
+#define ROUND_TRIPS 100000
+#define FRAMES 2000
+#define PAGE_SIZE (640 * 480 * 4)
+
+/* Answers ROUND_TRIPS pings, then reads FRAMES pages */
+static int child(void)
+{
+  HANDLE ping = IPC_openEvent(PING_EVENT_NAME);
+  HANDLE pong = IPC_openEvent(PONG_EVENT_NAME);
+  unsigned * page = IPC_openSharedMemory(PAGE_SECTION_NAME);
+  unsigned sum = 0;
+  int i, j;
+  if(ping == NULL || pong == NULL || page == NULL)
+  {
+    fprintf(stderr, "ipcbench: can not open shared objects\n");
+    return 1;
+  }
+  for(i = 0; i != ROUND_TRIPS; i++)
+  {
+    IPC_waitEvent(ping);
+    IPC_raiseEvent(pong);
+  }
+  for(i = 0; i != FRAMES; i++)
+  {
+    IPC_waitEvent(ping);
+    for(j = 0; j != PAGE_SIZE / 4; j++)
+      sum += page[j];
+    page[0] = sum;
+    IPC_raiseEvent(pong);
+  }
+  IPC_closeSharedMemory(page);
+  IPC_closeObject(ping);
+  IPC_closeObject(pong);
+  return 0;
+}
+
+#ifdef _WIN32
+
+static HANDLE startChild(void)
+{
+  char fileName[MAX_PATH], commandLine[MAX_PATH + 16];
+  STARTUPINFO si;
+  PROCESS_INFORMATION pi;
+  ZeroMemory(&si, sizeof(si));
+  si.cb = sizeof(si);
+  GetModuleFileName(NULL, fileName, sizeof(fileName));
+  sprintf(commandLine, "\"%s\" child", fileName);
+  if(!CreateProcess(fileName, commandLine, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi))
+    return NULL;
+  CloseHandle(pi.hThread);
+  return pi.hProcess;
+}
+
+static void waitChild(HANDLE process)
+{
+  WaitForSingleObject(process, INFINITE);
+  CloseHandle(process);
+}
+
+#else
+
+static pid_t startChild(void)
+{
+  pid_t pid = fork();
+  if(pid == 0)
+    _exit(child());
+  return pid;
+}
+
+static void waitChild(pid_t pid)
+{
+  int status;
+  waitpid(pid, &status, 0);
+}
+
+#endif
+
+int main(int argc, char ** argv)
+{
+  HANDLE ping, pong;
+  unsigned * page, * frame;
+  double start, time;
+  int i;
+#ifdef _WIN32
+  HANDLE process;
+#else
+  pid_t process;
+#endif
+
+  if(argc > 1 && strcmp(argv[1], "child") == 0)
+    return child();
+
+  ping = IPC_createEvent(PING_EVENT_NAME);
+  pong = IPC_createEvent(PONG_EVENT_NAME);
+  page = IPC_createSharedMemory(PAGE_SECTION_NAME, PAGE_SIZE);
+  frame = malloc(PAGE_SIZE);
+  if(ping == NULL || pong == NULL || page == NULL || frame == NULL)
+  {
+    fprintf(stderr, "ipcbench: can not create shared objects\n");
+    return 1;
+  }
+  process = startChild();
+
+  start = BENCH_now();
+  for(i = 0; i != ROUND_TRIPS; i++)
+  {
+    IPC_raiseEvent(ping);
+    IPC_waitEvent(pong);
+  }
+  time = BENCH_now() - start;
+  BENCH_report("event round trip", time / ROUND_TRIPS * 1e6, "us");
+  BENCH_report("event round trips per second", ROUND_TRIPS / time, "1/s");
+
+  start = BENCH_now();
+  for(i = 0; i != FRAMES; i++)
+  {
+    memset(frame, i, PAGE_SIZE);
+    memcpy(page, frame, PAGE_SIZE);
+    IPC_raiseEvent(ping);
+    IPC_waitEvent(pong);
+  }
+  time = BENCH_now() - start;
+  BENCH_report("shared page throughput", (double)PAGE_SIZE * FRAMES / time / (1 << 20), "MB/s");
+  BENCH_report("shared pages per second", FRAMES / time, "1/s");
+
+  waitChild(process);
+  free(frame);
+  IPC_closeSharedMemory(page);
+  IPC_closeObject(ping);
+  IPC_closeObject(pong);
+  return 0;
+}
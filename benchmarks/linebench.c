@@ -0,0 +1,118 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Lines per second of software rasterizer, measured on plain memory
+ * (no window, no GDI): short and long, horizontal, vertical and
+ * diagonal lines, solid, styled and thick, copied and XORed, on 4bpp
+ * and 32bpp surfaces.
+ */
+
+#include "bench.h"
+#include <Raster.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define LINES 200000
+#define POINTS 1024
+
+/* Kinds of generated lines */
+enum { ANY, HORIZONTAL, VERTICAL };
+
+static int points[POINTS][4];
+
+static void generate(int kind, int length)
+{
+  int i, x, y, dx, dy;
+  srand(1);
+  for(i = 0; i != POINTS; i++)
+  {
+    x = rand() % WIDTH;
+    y = rand() % HEIGHT;
+    dx = kind == VERTICAL ? 0 : rand() % (2 * length + 1) - length;
+    dy = kind == HORIZONTAL ? 0 : rand() % (2 * length + 1) - length;
+    points[i][0] = x;
+    points[i][1] = y;
+    points[i][2] = x + dx;
+    points[i][3] = y + dy;
+  }
+}
+
+/* Returns lines per second */
+static double lines(RASTER_CONTEXT * ctx)
+{
+  int i;
+  const int * p;
+  double start = BENCH_now();
+  for(i = 0; i != LINES; i++)
+  {
+    p = points[i % POINTS];
+    RASTER_line(ctx, p[0], p[1], p[2], p[3]);
+  }
+  return LINES / (BENCH_now() - start);
+}
+
+static void run(int bpp)
+{
+  static const struct { const char * name; int kind, length; } shapes[] =
+  {
+    { "short", ANY, 8 },
+    { "long", ANY, 400 },
+    { "horizontal", HORIZONTAL, 400 },
+    { "vertical", VERTICAL, 400 }
+  };
+  static const struct { const char * name; unsigned pattern; int width, mode; } styles[] =
+  {
+    { "solid", RASTER_SOLID_LINE, 1, RASTER_COPY },
+    { "dashed", 0xFC78, 1, RASTER_COPY },
+    { "thick", RASTER_SOLID_LINE, 3, RASTER_COPY },
+    { "XOR", RASTER_SOLID_LINE, 1, RASTER_XOR }
+  };
+  int shape, style;
+  char title[64];
+  RASTER_CONTEXT ctx;
+  void * bits = malloc(RASTER_stride(WIDTH, bpp) * HEIGHT);
+  memset(&ctx, 0, sizeof(ctx));
+  RASTER_initSurface(&ctx.surface, bits, WIDTH, HEIGHT, bpp);
+  ctx.clipRight = WIDTH - 1;
+  ctx.clipBottom = HEIGHT - 1;
+  ctx.color = bpp == 32 ? 0xFFFF00 : 14;
+  for(shape = 0; shape != sizeof(shapes) / sizeof(shapes[0]); shape++)
+  {
+    generate(shapes[shape].kind, shapes[shape].length);
+    for(style = 0; style != sizeof(styles) / sizeof(styles[0]); style++)
+    {
+      ctx.linePattern = styles[style].pattern;
+      ctx.lineWidth = styles[style].width;
+      ctx.writeMode = styles[style].mode;
+      sprintf(title, "%dbpp %s %s", bpp, shapes[shape].name, styles[style].name);
+      BENCH_report(title, lines(&ctx) / 1e3, "Klines/s");
+    }
+  }
+  free(bits);
+}
+
+int main(void)
+{
+  run(4);
+  run(32);
+  return 0;
+}
@@ -0,0 +1,149 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Workload of samples/particles.c (n^2 physics step, then double
+ * buffered clearviewport + circles) run in headless mode with and
+ * without PIPELINE. With pipeline physics of next frame runs while
+ * render thread draws current one, so on several cores frame rate is
+ * limited by the slower of them instead of their sum. On one core they
+ * can not overlap and pipeline must only be as fast as direct drawing:
+ * render thread is woken once per frame, not for every circle (that
+ * was 0.6x of direct rate), and measured 0.96-1.05x (RGB 0.87-1.01x).
+ */
+
+#include "bench.h"
+#include <graphics.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PARTICLE_NUMBER 150
+#define PARTICLE_RADIUS 2
+#define TIME_DELTA .0002
+#define EPS 1e4
+#define FRAMES 300
+#define WIDTH 1024
+#define HEIGHT 768
+
+typedef struct
+{
+  double x, y;
+  double speedX, speedY;
+} PARTICLE;
+
+static PARTICLE particles[PARTICLE_NUMBER];
+
+/* Lennard-Jones like force between two particles */
+static void interaction(const PARTICLE * active, const PARTICLE * passive, double * ax, double * ay)
+{
+  double norm = WIDTH / 20;
+  double dx = active->x - passive->x;
+  double dy = active->y - passive->y;
+  double dist = sqrt(dx * dx + dy * dy) + 1e-6;
+  double r = dist / norm;
+  double a = EPS * (1 / pow(r, 13) - 1 / pow(r, 7));
+  *ax += a * dx / dist;
+  *ay += a * dy / dist;
+}
+
+static void updateParticles(void)
+{
+  static PARTICLE next[PARTICLE_NUMBER];
+  int i, j;
+  for(i = 0; i != PARTICLE_NUMBER; i++)
+  {
+    double ax = 0, ay = 0;
+    for(j = 0; j != PARTICLE_NUMBER; j++)
+      if(i != j)
+        interaction(particles + i, particles + j, &ax, &ay);
+    next[i] = particles[i];
+    next[i].speedX += ax * TIME_DELTA;
+    next[i].speedY += ay * TIME_DELTA;
+    next[i].x += next[i].speedX * TIME_DELTA;
+    next[i].y += next[i].speedY * TIME_DELTA;
+  }
+  memcpy(particles, next, sizeof(particles));
+}
+
+static void drawParticles(void)
+{
+  int i;
+  for(i = 0; i != PARTICLE_NUMBER; i++)
+  {
+    setcolor(i % getmaxcolor() + 1);
+    circle(WIDTH / 2 + (int)particles[i].x, HEIGHT / 2 - (int)particles[i].y, PARTICLE_RADIUS);
+  }
+}
+
+static void initParticles(void)
+{
+  int i;
+  /* same start for every run, particles are placed on a grid */
+  srand(1);
+  for(i = 0; i != PARTICLE_NUMBER; i++)
+  {
+    particles[i].x = (i % 15) * 40 - 300;
+    particles[i].y = (i / 15) * 40 - 200;
+    particles[i].speedX = rand() % 500 - 250;
+    particles[i].speedY = rand() % 500 - 250;
+  }
+}
+
+/* Returns frames per second */
+static double run(const char * options)
+{
+  int gd = CUSTOM, gm = CUSTOM_MODE(WIDTH, HEIGHT);
+  int frame, page = 0;
+  double start, time;
+
+  initgraph(&gd, &gm, options);
+  initParticles();
+  start = BENCH_now();
+  for(frame = 0; frame != FRAMES; frame++)
+  {
+    updateParticles();
+    setactivepage(1 - page);
+    clearviewport();
+    drawParticles();
+    setvisualpage(1 - page);
+    page = 1 - page;
+  }
+  /* last frame must be on the page too */
+  getpixel(0, 0);
+  time = BENCH_now() - start;
+  closegraph();
+  return FRAMES / time;
+}
+
+int main(void)
+{
+  double direct, pipelined;
+  direct = run("HEADLESS");
+  BENCH_report("particles, direct", direct, "frames/s");
+  pipelined = run("HEADLESS PIPELINE");
+  BENCH_report("particles, pipeline", pipelined, "frames/s");
+  BENCH_report("particles, pipeline speedup", pipelined / direct, "x");
+  direct = run("HEADLESS RGB");
+  BENCH_report("particles RGB, direct", direct, "frames/s");
+  pipelined = run("HEADLESS RGB PIPELINE");
+  BENCH_report("particles RGB, pipeline", pipelined, "frames/s");
+  BENCH_report("particles RGB, pipeline speedup", pipelined / direct, "x");
+  return 0;
+}
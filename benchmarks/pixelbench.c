@@ -0,0 +1,86 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Cost of one putpixel and getpixel call: pixels of invisible page are
+ * written and read in order, in every color mode, with and without
+ * clipping viewport, and in pipeline mode.
+ */
+
+#include "bench.h"
+#include <graphics.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define PASSES 8
+
+/* Returns pixels per second */
+static double put(void)
+{
+  int x, y, pass;
+  double start = BENCH_now();
+  for(pass = 0; pass != PASSES; pass++)
+    for(y = 0; y != HEIGHT; y++)
+      for(x = 0; x != WIDTH; x++)
+        putpixel(x, y, x ^ y ^ pass);
+  getpixel(0, 0);
+  return (double)PASSES * WIDTH * HEIGHT / (BENCH_now() - start);
+}
+
+/* Returns pixels per second */
+static double get(void)
+{
+  int x, y, pass;
+  unsigned sum = 0;
+  double start = BENCH_now();
+  for(pass = 0; pass != PASSES; pass++)
+    for(y = 0; y != HEIGHT; y++)
+      for(x = 0; x != WIDTH; x++)
+        sum += getpixel(x, y);
+  /* sum is used, so reads are not thrown away */
+  if(sum == 1)
+    putpixel(0, 0, 0);
+  return (double)PASSES * WIDTH * HEIGHT / (BENCH_now() - start);
+}
+
+static void run(const char * name, const char * options)
+{
+  int gd = CUSTOM, gm = CUSTOM_MODE(WIDTH, HEIGHT), clip;
+  char title[64];
+  initgraph(&gd, &gm, options);
+  setactivepage(1);
+  for(clip = 0; clip <= 1; clip++)
+  {
+    setviewport(0, 0, WIDTH - 1, HEIGHT - 1, clip);
+    sprintf(title, "%s%s putpixel", name, clip ? ", clipped" : "");
+    BENCH_report(title, put() / 1e6, "Mpixels/s");
+    sprintf(title, "%s%s getpixel", name, clip ? ", clipped" : "");
+    BENCH_report(title, get() / 1e6, "Mpixels/s");
+  }
+  closegraph();
+}
+
+int main(void)
+{
+  /* windowed on Win32, headless elsewhere */
+  run("16 colors", "");
+  run("RGB", "RGB");
+  run("16 colors, pipeline", "PIPELINE");
+  return 0;
+}
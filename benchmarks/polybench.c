@@ -0,0 +1,108 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Polygons per second of scanline polygon filler on plain 32bpp memory:
+ * convex (regular polygon), concave (star with alternating radii) and
+ * self-intersecting (vertices at random points of circle) polygons of
+ * 10 to 100000 vertices, covering most of the screen, filled by both
+ * fill rules.
+ */
+
+#include "bench.h"
+#include <Raster.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define MAX_VERTICES 100000
+/* Every measurement lasts at least that long (seconds) */
+#define DURATION 0.5
+
+enum { CONVEX, CONCAVE, SELF_INTERSECTING };
+
+static int points[MAX_VERTICES * 2];
+
+static void generate(int kind, int count)
+{
+  int i;
+  double angle, radius;
+  srand(1);
+  for(i = 0; i != count; i++)
+  {
+    angle = 2 * 3.14159265358979 * i / count;
+    radius = HEIGHT / 2 - 1;
+    if(kind == CONCAVE && (i & 1))
+      radius /= 3;
+    if(kind == SELF_INTERSECTING)
+      angle = 2 * 3.14159265358979 * rand() / RAND_MAX;
+    points[i * 2] = WIDTH / 2 + (int)(radius * cos(angle));
+    points[i * 2 + 1] = HEIGHT / 2 + (int)(radius * sin(angle));
+  }
+}
+
+/* Returns polygons per second */
+static double polygons(RASTER_CONTEXT * ctx, int count)
+{
+  int filled = 0;
+  double start = BENCH_now(), elapsed;
+  do
+  {
+    RASTER_fillPoly(ctx, count, points);
+    filled++;
+    elapsed = BENCH_now() - start;
+  }
+  while(elapsed < DURATION);
+  return filled / elapsed;
+}
+
+int main(void)
+{
+  static const char * kinds[] = {"convex", "concave", "self-intersecting"};
+  static const char * rules[] = {"even-odd", "nonzero"};
+  int kind, count, rule;
+  char title[64];
+  RASTER_CONTEXT ctx;
+  RASTER_SCRATCH scratch = {NULL, 0};
+  void * bits = malloc(RASTER_stride(WIDTH, 32) * HEIGHT);
+  memset(&ctx, 0, sizeof(ctx));
+  RASTER_initSurface(&ctx.surface, bits, WIDTH, HEIGHT, 32);
+  ctx.clipRight = WIDTH - 1;
+  ctx.clipBottom = HEIGHT - 1;
+  ctx.fillColor = 0xFFFF00;
+  memset(ctx.fillPattern, 0xFF, sizeof(ctx.fillPattern));
+  RASTER_expandFill(&ctx);
+  ctx.scratch = &scratch;
+  for(kind = CONVEX; kind <= SELF_INTERSECTING; kind++)
+    for(count = 10; count <= MAX_VERTICES; count *= 10)
+    {
+      generate(kind, count);
+      for(rule = RASTER_EVENODD; rule <= RASTER_NONZERO; rule++)
+      {
+        ctx.fillRule = rule;
+        sprintf(title, "%s %d vertices %s", kinds[kind], count, rules[rule]);
+        BENCH_report(title, polygons(&ctx, count), "polygons/s");
+      }
+    }
+  RASTER_freeScratch(&scratch);
+  free(bits);
+  return 0;
+}
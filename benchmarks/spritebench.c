@@ -0,0 +1,117 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Sprites per second of a game-like screen: frames of hundreds of
+ * 32x32 balls (transparent corners) at random places are drawn on
+ * invisible page. Balls are drawn as opaque putimage (for reference,
+ * corners are not transparent), as classic mask and image pair
+ * (putimage AND_PUT, then OR_PUT) and as compiled sprites.
+ */
+
+#include "bench.h"
+#include <graphics.h>
+#include <stdlib.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define SIZE 32
+#define SPRITES 500
+#define FRAMES 200
+
+enum { OPAQUE, MASKED, SPRITE };
+
+static void * ball, * mask, * sprite;
+
+/* Ball is drawn on page and read, mask has all bits where ball is transparent */
+static void createImages(void)
+{
+  int x, y, * pixels;
+  unsigned size = imagesize(0, 0, SIZE - 1, SIZE - 1);
+  ball = malloc(size);
+  mask = malloc(size);
+  cleardevice();
+  setcolor(getmaxcolor());
+  setfillstyle(SOLID_FILL, getmaxcolor() == 15 ? LIGHTRED : rgb(255, 64, 64));
+  fillellipse(SIZE / 2, SIZE / 2, SIZE / 2 - 1, SIZE / 2 - 1);
+  getimage(0, 0, SIZE - 1, SIZE - 1, ball);
+  getimage(0, 0, SIZE - 1, SIZE - 1, mask);
+  pixels = (int *)mask + 2;
+  for(y = 0; y != SIZE; y++)
+    for(x = 0; x != SIZE; x++, pixels++)
+      *pixels = *pixels == 0 ? getmaxcolor() == 15 ? 0xF : 0xFFFFFF : 0;
+  sprite = createsprite(ball, BLACK);
+  cleardevice();
+}
+
+/* Returns sprites per second */
+static double frames(int kind)
+{
+  int frame, i, x, y;
+  double start;
+  srand(1);
+  start = BENCH_now();
+  for(frame = 0; frame != FRAMES; frame++)
+  {
+    for(i = 0; i != SPRITES; i++)
+    {
+      x = rand() % (WIDTH + SIZE) - SIZE;
+      y = rand() % (HEIGHT + SIZE) - SIZE;
+      if(kind == OPAQUE)
+        putimage(x, y, ball, COPY_PUT);
+      else if(kind == MASKED)
+      {
+        putimage(x, y, mask, AND_PUT);
+        putimage(x, y, ball, OR_PUT);
+      }
+      else
+        drawsprite(x, y, sprite);
+    }
+  }
+  getpixel(0, 0);
+  return (double)FRAMES * SPRITES / (BENCH_now() - start);
+}
+
+static void run(const char * name, const char * options)
+{
+  static const char * kinds[] = {"opaque putimage", "masked putimage", "sprite"};
+  int gd = CUSTOM, gm = CUSTOM_MODE(WIDTH, HEIGHT), kind;
+  char title[64];
+  initgraph(&gd, &gm, options);
+  setactivepage(1);
+  createImages();
+  for(kind = OPAQUE; kind <= SPRITE; kind++)
+  {
+    sprintf(title, "%s %s", name, kinds[kind]);
+    BENCH_report(title, frames(kind) / 1e3, "Ksprites/s");
+  }
+  freesprite(sprite);
+  free(ball);
+  free(mask);
+  closegraph();
+}
+
+int main(void)
+{
+  /* windowed on Win32, headless elsewhere */
+  run("16 colors", "");
+  run("RGB", "RGB");
+  run("16 colors, pipeline", "PIPELINE");
+  return 0;
+}
@@ -0,0 +1,91 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Labels per second of a dashboard-like screen: frames of short labels
+ * (values with units) in cells of a grid, with all justifications, two
+ * sizes and some vertical axis titles, every label is measured by
+ * textwidth first like layout code does. Labels are drawn on invisible
+ * page with DEFAULT_FONT, and with TRIPLEX_FONT if TRIP.CHR is in
+ * current directory (stroked labels are drawn again and again, so they
+ * are measured with warm cache of scaled strokes).
+ */
+
+#include "bench.h"
+#include <graphics.h>
+#include <stdlib.h>
+
+#define WIDTH 640
+#define HEIGHT 480
+#define LABELS 400
+#define FRAMES 100
+
+/* Returns labels per second */
+static double frames(int font)
+{
+  int frame, i, x, y, width = 0;
+  char label[32];
+  double start = BENCH_now();
+  for(frame = 0; frame != FRAMES; frame++)
+  {
+    for(i = 0; i != LABELS; i++)
+    {
+      x = i % 20 * (WIDTH / 20) + 16;
+      y = i / 20 * (HEIGHT / 20) + 12;
+      sprintf(label, "%d.%d ms", (frame * 31 + i * 7) % 1000, i % 10);
+      setcolor(i % getmaxcolor() + 1);
+      if(i % 50 == 0)
+        settextstyle(font, VERT_DIR, 1);
+      else
+        settextstyle(font, HORIZ_DIR, i % 10 == 0 ? 2 : 1);
+      settextjustify(i % 3, i / 3 % 3);
+      width += textwidth(label);
+      outtextxy(x, y, label);
+    }
+  }
+  getpixel(0, 0);
+  /* width is used, so measuring is not optimized out */
+  return (double)FRAMES * LABELS / (BENCH_now() - start) + (width < 0);
+}
+
+static void run(const char * name, const char * options)
+{
+  int gd = CUSTOM, gm = CUSTOM_MODE(WIDTH, HEIGHT);
+  char title[64];
+  initgraph(&gd, &gm, options);
+  setactivepage(1);
+  sprintf(title, "%s labels", name);
+  BENCH_report(title, frames(DEFAULT_FONT) / 1e3, "Klabels/s");
+  settextstyle(TRIPLEX_FONT, HORIZ_DIR, 1);
+  if(graphresult() == grOk)
+  {
+    sprintf(title, "%s stroked labels", name);
+    BENCH_report(title, frames(TRIPLEX_FONT) / 1e3, "Klabels/s");
+  }
+  closegraph();
+}
+
+int main(void)
+{
+  /* windowed on Win32, headless elsewhere */
+  run("16 colors", "");
+  run("RGB", "RGB");
+  run("16 colors, pipeline", "PIPELINE");
+  return 0;
+}
@@ -0,0 +1,64 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __ATOMIC_H__
+#define __ATOMIC_H__
+
+/**
+ * Minimal set of memory-ordered operations needed for lock-free
+ * structures shared by client and server (they may live in different
+ * processes, so only plain memory in shared sections is used).
+ *
+ * ATOMIC_loadAcquire  - reads value, later reads can not move before it
+ * ATOMIC_storeRelease - writes value, earlier writes can not move after it
+ * ATOMIC_exchange     - writes value and returns previous one, full barrier
+ */
+#if defined(__GNUC__)
+
+#define ATOMIC_loadAcquire(P) __atomic_load_n((P), __ATOMIC_ACQUIRE)
+#define ATOMIC_storeRelease(P, V) __atomic_store_n((P), (V), __ATOMIC_RELEASE)
+#define ATOMIC_exchange(P, V) __atomic_exchange_n((P), (V), __ATOMIC_SEQ_CST)
+
+#elif defined(_MSC_VER)
+
+#include <intrin.h>
+
+/* x86 does not reorder loads with loads and stores with stores, only compiler does */
+static unsigned ATOMIC_loadAcquire_(volatile unsigned * p)
+{
+  unsigned value = *p;
+  _ReadWriteBarrier();
+  return value;
+}
+
+static void ATOMIC_storeRelease_(volatile unsigned * p, unsigned value)
+{
+  _ReadWriteBarrier();
+  *p = value;
+}
+
+#define ATOMIC_loadAcquire(P) ATOMIC_loadAcquire_(P)
+#define ATOMIC_storeRelease(P, V) ATOMIC_storeRelease_((P), (V))
+#define ATOMIC_exchange(P, V) ((unsigned)_InterlockedExchange((volatile long *)(P), (long)(V)))
+
+#else
+  #error Atomic operations are not implemented for this compiler
+#endif
+
+#endif
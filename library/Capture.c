@@ -0,0 +1,342 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Capture.h"
+#include "BGI.H"
+#include "IPC.h"
+#include "Atomic.h"
+#include "Raster.h"
+#include "graphics.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/* Y4M has no variable frame rate, frames are captured at setvisualpage */
+#define CAPTURE_Y4M_RATE 60
+/* Shorter runs of unchanged pixels are not worth a new run in delta format */
+#define CAPTURE_MIN_SKIP 4
+
+/* Copy of page waiting for writer */
+typedef struct
+{
+  unsigned char * bits;
+  RGBQUAD palette[BGI_PALETTE_SIZE];
+} CAPTURE_BUFFER;
+
+/**
+ * Pool of buffers is single-producer/single-consumer ring: program
+ * thread moves head, writer moves tail, counters grow infinitely.
+ */
+static struct
+{
+  int active;
+  int format;
+  int width, height, bpp;
+  int stride;
+  FILE * file;
+  CAPTURE_BUFFER buffers[CAPTURE_BUFFERS];
+  volatile unsigned head;
+  volatile unsigned tail;
+  volatile unsigned stopping;
+  /* raised when frame is queued or capture stops */
+  HANDLE event;
+  HANDLE thread;
+  /* writer state: current and previous frames in RGB */
+  unsigned char * rgb;
+  unsigned char * previous;
+  unsigned frames;
+  unsigned dropped;
+  double bytes;
+} capture;
+
+static void writeBytes(const void * data, size_t size)
+{
+  capture.bytes += fwrite(data, 1, size, capture.file);
+}
+
+static void writeInt(unsigned value)
+{
+  unsigned char b[4];
+  b[0] = (unsigned char)value;
+  b[1] = (unsigned char)(value >> 8);
+  b[2] = (unsigned char)(value >> 16);
+  b[3] = (unsigned char)(value >> 24);
+  writeBytes(b, 4);
+}
+
+/* Converts page copy to top-down RGB in capture.rgb */
+static void convertFrame(const CAPTURE_BUFFER * buffer)
+{
+  int x, y;
+  unsigned pixel;
+  const unsigned char * row;
+  const RGBQUAD * color;
+  unsigned char * out = capture.rgb;
+  for(y = 0; y != capture.height; y++)
+  {
+    /* pages are bottom-up */
+    row = buffer->bits + (capture.height - 1 - y) * capture.stride;
+    if(capture.bpp == 32)
+    {
+      for(x = 0; x != capture.width; x++, row += 4, out += 3)
+      {
+        out[0] = row[2];
+        out[1] = row[1];
+        out[2] = row[0];
+      }
+    }
+    else if(capture.bpp == 16)
+    {
+      /* RGB565, top bits of components are repeated in low ones */
+      for(x = 0; x != capture.width; x++, out += 3)
+      {
+        pixel = ((const unsigned short *)row)[x];
+        out[0] = (unsigned char)((pixel >> 8 & 0xF8) | pixel >> 13);
+        out[1] = (unsigned char)((pixel >> 3 & 0xFC) | (pixel >> 9 & 0x3));
+        out[2] = (unsigned char)((pixel << 3 & 0xF8) | (pixel >> 2 & 0x7));
+      }
+    }
+    else
+    {
+      for(x = 0; x != capture.width; x++, out += 3)
+      {
+        /* even pixel of 4bpp page is in high nibble */
+        if(capture.bpp == 8)
+          color = buffer->palette + row[x];
+        else
+          color = buffer->palette + ((x & 1) ? row[x >> 1] & 0xF : row[x >> 1] >> 4);
+        out[0] = color->rgbRed;
+        out[1] = color->rgbGreen;
+        out[2] = color->rgbBlue;
+      }
+    }
+  }
+}
+
+static void writeY4M(void)
+{
+  int i, count = capture.width * capture.height, r, g, b;
+  const unsigned char * p;
+  unsigned char * plane = capture.previous;
+  writeBytes("FRAME\n", 6);
+  /* planes are written one by one through previous frame buffer, it is not used in this format */
+  for(i = 0, p = capture.rgb; i != count; i++, p += 3)
+    plane[i] = (unsigned char)(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+  writeBytes(plane, count);
+  for(i = 0, p = capture.rgb; i != count; i++, p += 3)
+  {
+    r = p[0];
+    g = p[1];
+    b = p[2];
+    plane[i] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+  }
+  writeBytes(plane, count);
+  for(i = 0, p = capture.rgb; i != count; i++, p += 3)
+  {
+    r = p[0];
+    g = p[1];
+    b = p[2];
+    plane[i] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+  }
+  writeBytes(plane, count);
+}
+
+static int samePixel(int i)
+{
+  return memcmp(capture.rgb + i * 3, capture.previous + i * 3, 3) == 0;
+}
+
+/* Length of run of unchanged pixels from i */
+static int skipLength(int i, int count)
+{
+  int start = i;
+  while(i != count && samePixel(i))
+    i++;
+  return i - start;
+}
+
+static void writeDelta(void)
+{
+  int i = 0, count = capture.width * capture.height, skip, copy;
+  long sizePos, endPos;
+  /* size of frame is known when it is written */
+  sizePos = ftell(capture.file);
+  writeInt(0);
+  while(i != count)
+  {
+    skip = skipLength(i, count);
+    i += skip;
+    copy = 0;
+    /* copy run lasts until long enough unchanged run or end of frame */
+    while(i + copy != count)
+    {
+      if(samePixel(i + copy) && skipLength(i + copy, count) >= CAPTURE_MIN_SKIP)
+        break;
+      copy++;
+    }
+    writeInt(skip);
+    writeInt(copy);
+    writeBytes(capture.rgb + i * 3, copy * 3);
+    i += copy;
+  }
+  endPos = ftell(capture.file);
+  fseek(capture.file, sizePos, SEEK_SET);
+  writeInt((unsigned)(endPos - sizePos - 4));
+  /* size is not counted twice */
+  capture.bytes -= 4;
+  fseek(capture.file, endPos, SEEK_SET);
+  memcpy(capture.previous, capture.rgb, count * 3);
+}
+
+static void writeFrame(const CAPTURE_BUFFER * buffer)
+{
+  convertFrame(buffer);
+  switch(capture.format)
+  {
+  case CAPTURE_Y4M:
+    writeY4M();
+    break;
+  case CAPTURE_DELTA:
+    writeDelta();
+    break;
+  default:
+    writeBytes(capture.rgb, capture.width * capture.height * 3);
+  }
+  capture.frames++;
+}
+
+static void writeHeader(void)
+{
+  char header[64];
+  switch(capture.format)
+  {
+  case CAPTURE_Y4M:
+    sprintf(header, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", capture.width, capture.height, CAPTURE_Y4M_RATE);
+    writeBytes(header, strlen(header));
+    break;
+  case CAPTURE_DELTA:
+    writeBytes("BGIDELTA", 8);
+    writeInt(capture.width);
+    writeInt(capture.height);
+    break;
+  }
+}
+
+/* Writer thread: writes queued frames until capture is stopped */
+static void writerProc(void * param)
+{
+  unsigned tail = capture.tail;
+  for(;;)
+  {
+    if(tail != ATOMIC_loadAcquire(&capture.head))
+    {
+      writeFrame(capture.buffers + tail % CAPTURE_BUFFERS);
+      /* buffer may be reused after that */
+      ATOMIC_storeRelease(&capture.tail, ++tail);
+      continue;
+    }
+    /* queue is checked once more after stop, so nothing is left */
+    if(ATOMIC_loadAcquire(&capture.stopping) && tail == ATOMIC_loadAcquire(&capture.head))
+      break;
+    IPC_waitEvent(capture.event);
+  }
+}
+
+int CAPTURE_start(const char * path, int format, int width, int height, int bpp)
+{
+  int i, frameSize;
+  if(capture.active)
+    CAPTURE_stop();
+  capture.file = fopen(path, "wb");
+  if(capture.file == NULL)
+    return 0;
+  capture.format = format;
+  capture.width = width;
+  capture.height = height;
+  capture.bpp = bpp;
+  capture.stride = RASTER_stride(width, bpp);
+  capture.head = capture.tail = capture.stopping = 0;
+  capture.frames = capture.dropped = 0;
+  capture.bytes = 0;
+  frameSize = capture.stride * height;
+  /* everything is allocated here, capturing frame does not allocate */
+  for(i = 0; i != CAPTURE_BUFFERS; i++)
+  {
+    capture.buffers[i].bits = BGI_malloc(frameSize);
+    assert(capture.buffers[i].bits != NULL);
+  }
+  capture.rgb = BGI_malloc(width * height * 3);
+  capture.previous = BGI_malloc(width * height * 3);
+  assert(capture.rgb != NULL && capture.previous != NULL);
+  memset(capture.previous, 0, width * height * 3);
+  writeHeader();
+  capture.event = IPC_createEvent(NULL);
+  capture.thread = IPC_startThread(writerProc, NULL);
+  assert(capture.thread != NULL);
+  capture.active = 1;
+  return 1;
+}
+
+void CAPTURE_frame(const void * bits, const RGBQUAD * palette)
+{
+  CAPTURE_BUFFER * buffer;
+  if(!capture.active)
+    return;
+  /* writer is behind by whole pool */
+  if(capture.head - ATOMIC_loadAcquire(&capture.tail) == CAPTURE_BUFFERS)
+  {
+    capture.dropped++;
+    return;
+  }
+  buffer = capture.buffers + capture.head % CAPTURE_BUFFERS;
+  memcpy(buffer->bits, bits, capture.stride * capture.height);
+  if(capture.bpp <= 8)
+    memcpy(buffer->palette, palette, sizeof(buffer->palette));
+  ATOMIC_storeRelease(&capture.head, capture.head + 1);
+  IPC_raiseEvent(capture.event);
+}
+
+void CAPTURE_stop(void)
+{
+  int i;
+  if(!capture.active)
+    return;
+  ATOMIC_exchange(&capture.stopping, 1);
+  IPC_raiseEvent(capture.event);
+  IPC_joinThread(capture.thread);
+  IPC_closeObject(capture.event);
+  fclose(capture.file);
+  for(i = 0; i != CAPTURE_BUFFERS; i++)
+    BGI_free(capture.buffers[i].bits);
+  BGI_free(capture.rgb);
+  BGI_free(capture.previous);
+  capture.active = 0;
+}
+
+int CAPTURE_active(void)
+{
+  return capture.active;
+}
+
+void CAPTURE_stats(unsigned * frames, unsigned * dropped, double * bytes)
+{
+  *frames = capture.frames;
+  *dropped = capture.dropped;
+  *bytes = capture.bytes;
+}
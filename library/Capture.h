@@ -0,0 +1,55 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include "Platform.h"
+
+/**
+ * Frame capture (startcapture). Program thread only copies page bits
+ * and palette into one of preallocated buffers, writer thread converts
+ * them to RGB and writes to file. If all buffers are waiting for writer
+ * frame is dropped, so drawing never waits for disk.
+ *
+ * File formats (see CAPTURE_* in graphics.h):
+ * raw   - frames of 24-bit RGB pixels, rows from top to bottom
+ * Y4M   - YUV4MPEG2 stream, 4:4:4, BT.601 colors
+ * delta - "BGIDELTA", width and height (32-bit little endian), then
+ *         frames: 32-bit size of frame data and runs of
+ *         (skip, count, count RGB pixels) that cover whole frame,
+ *         skipped pixels are same as in previous frame (first frame
+ *         is compared with black one)
+ */
+
+/* Buffers in pool: how many frames writer may be behind */
+#define CAPTURE_BUFFERS 8
+
+/* Opens file and starts writer thread. Returns 0 if file can not be created */
+int CAPTURE_start(const char * path, int format, int width, int height, int bpp);
+/* Queues copy of page for writer, palette is used by 4bpp and 8bpp pages */
+void CAPTURE_frame(const void * bits, const RGBQUAD * palette);
+/* Writes queued frames, stops writer and closes file */
+void CAPTURE_stop(void);
+/* If capture is started */
+int CAPTURE_active(void);
+/* Counters of current (or last) capture */
+void CAPTURE_stats(unsigned * frames, unsigned * dropped, double * bytes);
+
+#endif
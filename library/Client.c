@@ -17,14 +17,18 @@
   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-#include "BGI.h"
+#include "BGI.H"
 #include "IPC.h"
+#include "Atomic.h"
+#include "Render.h"
 #include "graphics.h"
 #include <stdio.h>
 #include <assert.h>
-#include <process.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef _WIN32
+  #include <process.h>
+#endif
 
 /* Contains some attributes of server window */
 static struct
@@ -33,12 +37,127 @@ static struct
   HDC dc;
   int width, height;
   int mode;
+  int pageCount;
 } window;
 
 static SHARED_STRUCT * sharedStruct;
+static PAGE pages[BGI_MAX_PAGES];
+#ifdef _WIN32
+/* MODE_256 and MODE_HICOLOR: 32bpp page that pages are expanded to when they are presented */
+static PAGE expandedPage;
 static SHARED_OBJECTS sharedObjects;
-static PAGE pages[2];
 static HANDLE serverCheckerThread;
+#endif
+
+/* Used instead of shared memory when there is no server (MODE_HEADLESS) */
+static SHARED_STRUCT headlessStruct;
+/* Render thread of MODE_HEADLESS | MODE_PIPELINE runs in this process */
+static RENDER_PLAYER headlessPlayer;
+static HANDLE headlessRenderThread;
+
+/* Starts recording primitives to queue that render thread draws */
+static void startRecording(RENDER_QUEUE * queue, HANDLE commandEvent, HANDLE doneEvent)
+{
+  void * pageBits[BGI_MAX_PAGES];
+  int pc;
+  for(pc = 0; pc != window.pageCount; pc++)
+    pageBits[pc] = pages[pc].bits;
+  RENDER_startRecording(queue, commandEvent, doneEvent, pageBits, window.pageCount);
+}
+
+static void showHeadlessPage(int page)
+{
+  BGI_setVisualPage(page);
+}
+
+static void addHeadlessDamage(int page, int left, int top, int right, int bottom)
+{
+  BGI_addDamage(&headlessStruct.damage, page, left, top, right, bottom);
+}
+
+static void headlessRenderThreadProc(void * player)
+{
+  RENDER_play(player);
+}
+
+static int startHeadlessPipeline(int width, int height, int mode)
+{
+  int pc;
+  RENDER_PLAYER * player = &headlessPlayer;
+  player->queue = BGI_malloc(sizeof(RENDER_QUEUE));
+  if(player->queue == NULL)
+    return 0;
+  memset(player->queue, 0, sizeof(RENDER_QUEUE));
+  player->commandEvent = IPC_createEvent(NULL);
+  player->doneEvent = IPC_createEvent(NULL);
+  for(pc = 0; pc != window.pageCount; pc++)
+    RASTER_initSurface(player->surfaces + pc, pages[pc].bits, width, height, MODE_BPP(mode));
+  player->showPage = showHeadlessPage;
+  player->damage = addHeadlessDamage;
+  player->present = BGI_presentFrame;
+  headlessRenderThread = IPC_startThread(headlessRenderThreadProc, player);
+  assert(headlessRenderThread != NULL);
+  startRecording(player->queue, player->commandEvent, player->doneEvent);
+  return 1;
+}
+
+/* Frees first count pages and palette of headless mode */
+static void freeHeadlessPages(int count)
+{
+  int pc;
+  for(pc = 0; pc != count; pc++)
+    BGI_destroyPage(pages + pc);
+  BGI_free(BGI_palette);
+  BGI_palette = NULL;
+}
+
+/**
+ * Headless mode: pages are allocated in current process memory,
+ * no window and no server are created. Returns 0 if there is no memory
+ */
+static int startHeadless(int width, int height, int mode)
+{
+  int pc;
+  window.wnd = NULL;
+  window.dc = NULL;
+  BGI_palette = BGI_malloc(sizeof(RGBQUAD) * BGI_PALETTE_SIZE);
+  BGI_initPalette();
+  memset(&headlessStruct, 0, sizeof(headlessStruct));
+  sharedStruct = &headlessStruct;
+  sharedStruct->pagesBpp = MODE_BPP(mode);
+  BGI_restartFrameClock();
+  for(pc = 0; pc != window.pageCount; pc++)
+  {
+    if(!BGI_createPage(pages + pc, NULL, NULL, width, height, MODE_BPP(mode)))
+    {
+      freeHeadlessPages(pc);
+      return 0;
+    }
+  }
+  if((mode & MODE_PIPELINE) && !startHeadlessPipeline(width, height, mode))
+  {
+    freeHeadlessPages(window.pageCount);
+    return 0;
+  }
+  return 1;
+}
+
+static void closeHeadless(void)
+{
+  if(window.mode & MODE_PIPELINE)
+  {
+    /* render thread must not touch pages after they are freed */
+    RENDER_stopRecording();
+    IPC_joinThread(headlessRenderThread);
+    IPC_closeObject(headlessPlayer.commandEvent);
+    IPC_closeObject(headlessPlayer.doneEvent);
+    BGI_free(headlessPlayer.queue);
+    headlessPlayer.queue = NULL;
+  }
+  freeHeadlessPages(window.pageCount);
+}
+
+#ifdef _WIN32
 
 /* Opens all server-side shared objects */
 void openSharedObjects(void)
@@ -46,13 +165,23 @@ void openSharedObjects(void)
   int i;
   sharedObjects.keyboardEvent = IPC_openEvent(KEYBOARD_MUTEX_NAME);
   sharedObjects.serverPresentMutex = IPC_openMutex(SERVER_PRESENT_MUTEX_NAME);
+  sharedObjects.controlEvent = IPC_openEvent(CONTROL_EVENT_NAME);
 
-  for(i = 0; i != 2; i++)
+  for(i = 0; i != window.pageCount; i++)
     sharedObjects.pagesSection[i] = IPC_openSection(PAGES_SECTION_NAME[i]);
 
   sharedStruct = IPC_openSharedMemory(SHARED_STRUCT_NAME);
   BGI_palette = IPC_openSharedMemory(PALETTE_SECTION_NAME);
   assert(sharedStruct != NULL);
+
+  sharedObjects.renderQueue = NULL;
+  if(window.mode & MODE_PIPELINE)
+  {
+    sharedObjects.renderCommandEvent = IPC_openEvent(RENDER_COMMAND_EVENT_NAME);
+    sharedObjects.renderDoneEvent = IPC_openEvent(RENDER_DONE_EVENT_NAME);
+    sharedObjects.renderQueue = IPC_openSharedMemory(RENDER_QUEUE_SECTION_NAME);
+    assert(sharedObjects.renderQueue != NULL);
+  }
 }
 
 /* Procedure of thread that checks for server presence */
@@ -70,7 +199,7 @@ static void serverThread(DWORD p)
 
 LPVOID static packParams(int w, int h, int mode)
 {
-  int r = ((w & 0xFFF) | ((h & 0xFFF) << 12)) + ((mode & 0xFFF) << 24);
+  int r = ((w & 0xFFF) | ((h & 0xFFF) << 12)) + (MODE_TO_SERVER(mode) << 24);
 #ifdef _Wp64  
   return (LPVOID)(__int64)r;
 #else
@@ -78,14 +207,22 @@ LPVOID static packParams(int w, int h, int mode)
 #endif
 }
 
-void BGI_startServer(int width, int height, int mode)
+#endif
+
+int BGI_startServer(int width, int height, int mode)
 {
+#ifdef _WIN32
   int pc;
   TCHAR fileName[128];
+#endif
   window.width = width;
   window.height = height;
   window.mode = mode;
-  
+  window.pageCount = MODE_PAGE_COUNT(mode);
+
+  if(mode & MODE_HEADLESS)
+    return startHeadless(width, height, mode);
+#ifdef _WIN32
   sharedObjects.clientPresentMutex = IPC_createMutex(CLIENT_PRESENT_MUTEX_NAME, TRUE);
   sharedObjects.serverCreatedEvent = IPC_createEvent(SERVER_STARTED_EVENT_NAME);
   if(mode & MODE_RELEASE)
@@ -111,13 +248,31 @@ void BGI_startServer(int width, int height, int mode)
   window.dc = GetDC(window.wnd);
 
   openSharedObjects();
+  /* client draws pages in format of its mode, server must have created them so */
+  assert(sharedStruct->pagesBpp == MODE_BPP(mode));
   if(mode & MODE_RELEASE)
     serverCheckerThread = NULL;
   else
     serverCheckerThread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)serverPresenceChecker, NULL, 0, NULL);
   
-  for(pc = 0; pc != 2; pc++)
-    BGI_createPage(pages + pc, window.dc,sharedObjects.pagesSection[pc], width, height, mode & MODE_RGB);
+  for(pc = 0; pc != window.pageCount; pc++)
+  {
+    if(!BGI_createPage(pages + pc, window.dc,sharedObjects.pagesSection[pc], width, height, MODE_BPP(mode)))
+    {
+      /* server and shared objects are closed as closegraph closes them */
+      BGI_closeWindow();
+      return 0;
+    }
+  }
+  if((mode & (MODE_256 | MODE_HICOLOR)) && !BGI_createPage(&expandedPage, window.dc, NULL, width, height, 32))
+  {
+    BGI_closeWindow();
+    return 0;
+  }
+  if(mode & MODE_PIPELINE)
+    startRecording(sharedObjects.renderQueue, sharedObjects.renderCommandEvent, sharedObjects.renderDoneEvent);
+#endif
+  return 1;
 }
 
 PAGE * BGI_getPages(void)
@@ -125,18 +280,133 @@ PAGE * BGI_getPages(void)
   return pages;
 }
 
+/**
+ * Copies damaged parts of visual page to window. In headless mode
+ * nothing is copied, but damage is taken and counted all the same,
+ * so present counters show what would be copied.
+ */
 void BGI_updateWindow(void)
 {
-  BitBlt(window.dc, 0, 0, window.width, window.height, pages[sharedStruct->visualPage].dc, 0, 0, SRCCOPY);
+  BGI_RECT rects[BGI_DAMAGE_RECTS];
+  int page, count;
+#ifdef _WIN32
+  int i;
+  HDC source;
+#endif
+  /* newest completed frame is shown, older ones are skipped */
+  BGI_takeFrame(sharedStruct, window.width, window.height);
+  page = sharedStruct->visualPage;
+  count = BGI_takeDamage(&sharedStruct->damage, page, rects, MODE_BPP(window.mode));
+#ifdef _WIN32
+  if(window.wnd == NULL)
+    return;
+  for(i = 0; i != count; i++)
+  {
+    source = pages[page].dc;
+    if(window.mode & (MODE_256 | MODE_HICOLOR))
+    {
+      BGI_expandPage(pages + page, MODE_BPP(window.mode), &expandedPage, window.width, window.height, rects + i);
+      source = expandedPage.dc;
+    }
+    BitBlt(
+      window.dc, 
+      rects[i].left, 
+      rects[i].top, 
+      rects[i].right - rects[i].left, 
+      rects[i].bottom - rects[i].top, 
+      source, 
+      rects[i].left, 
+      rects[i].top, 
+      SRCCOPY
+      );
+  }
+#else
+  (void)count;
+#endif
+}
+
+/* Wall clock time of last present by headless frame clock, in milliseconds */
+static unsigned lastPresent;
+
+void BGI_restartFrameClock(void)
+{
+  /* rate is at least 1 per second */
+  lastPresent = IPC_milliseconds() - 1000;
+}
+
+/* Frame clock of headless PRESENT_COALESCED mode */
+static int headlessFrameDue(void)
+{
+  unsigned now = IPC_milliseconds();
+  if(now - lastPresent < (unsigned)(1000 / sharedStruct->presentRate))
+    return 0;
+  lastPresent = now;
+  return 1;
+}
+
+void BGI_presentFrame(int explicitly)
+{
+  if(!explicitly)
+  {
+    switch(sharedStruct->presentMode)
+    {
+    case PRESENT_COALESCED:
+      /* server presents on its clock ticks */
+      if(!(window.mode & MODE_HEADLESS) || !headlessFrameDue())
+        return;
+      break;
+    case PRESENT_MANUAL:
+      return;
+    }
+  }
+  BGI_updateWindow();
 }
 
 void BGI_setVisualPage(int page)
 {
-  sharedStruct->visualPage = page;
+  BGI_publishFrame(sharedStruct, page);
+  /* nobody else presents in headless mode, frame is shown at once */
+  if(window.mode & MODE_HEADLESS)
+    BGI_takeFrame(sharedStruct, window.width, window.height);
 //  if(mode & MODE_SHOW_INVISIBLE_PAGE)
 //    SendMessage(window.wnd, WM_VISUALPAGE_CHANGED, 0, 0);
 }
 
+unsigned BGI_postControl(int type, int first, int count)
+{
+  BGI_CONTROL_QUEUE * queue = &sharedStruct->control;
+  unsigned sequence;
+
+  /* there is no server in headless mode, so messages are completed at once */
+  if(window.mode & MODE_HEADLESS)
+  {
+    queue->completed = ++queue->head;
+    return queue->head;
+  }
+
+  /* mailbox is full: wait until server takes oldest message */
+  while((sequence = BGI_pushControl(queue, type, first, count)) == 0)
+    BGI_waitControl(queue->head - BGI_CONTROL_QUEUE_SIZE + 1);
+#ifdef _WIN32
+  /* one WM_CONTROL wakes server for all messages posted before it is handled */
+  if(ATOMIC_exchange(&queue->wakePending, 1) == 0)
+    PostMessage(window.wnd, WM_CONTROL, 0, 0);
+#endif
+  return sequence;
+}
+
+void BGI_waitControl(unsigned sequence)
+{
+  BGI_CONTROL_QUEUE * queue = &sharedStruct->control;
+  /* counters wrap around, so they are compared by difference */
+  while((int)(ATOMIC_loadAcquire(&queue->completed) - sequence) < 0)
+  {
+#ifdef _WIN32
+    IPC_waitEvent(sharedObjects.controlEvent);
+#endif
+  }
+}
+
 SHARED_STRUCT * BGI_getSharedStruct()
 {
   return sharedStruct;
@@ -152,15 +422,7 @@ HWND BGI_getWindow()
   return window.wnd;
 }
 
-int BGI_waitForKeyPressed(void)
-{
-  int c;
-  while(sharedStruct->keyCode == -1)
-    Sleep(1);
-  c = sharedStruct->keyCode;
-  SendMessage(window.wnd, WM_KEYPROCESSED, 0, 0);
-  return c;
-}
+#ifdef _WIN32
 
 static int translateKeyCode(int code)
 {
@@ -188,37 +450,98 @@ static int translateKeyCode(int code)
   return code;
 }
 
+#endif
+
+int BGI_getEvent(BGI_EVENT * event)
+{
+  if(!BGI_popEvent(&sharedStruct->events, event))
+    return 0;
+#ifdef _WIN32
+  /* in headless mode events are not produced by server, codes are already ours */
+  if(event->type == BGI_EVENT_KEY && !(window.mode & MODE_HEADLESS))
+    event->key = translateKeyCode(event->key);
+#endif
+  return 1;
+}
+
+int BGI_anyKeyPressed(void)
+{
+  BGI_EVENT_QUEUE * queue = &sharedStruct->events;
+  unsigned i, head = ATOMIC_loadAcquire(&queue->head);
+  /* only consumer moves tail, so events can be looked through without taking */
+  for(i = queue->tail; i != head; i++)
+    if(queue->events[i & (BGI_EVENT_QUEUE_SIZE - 1)].type == BGI_EVENT_KEY)
+      return 1;
+  return 0;
+}
+
+/**
+ * Takes next key event, skipping mouse events (mouse state is
+ * still available in shared struct). Blocks until key is pressed.
+ * There is no keyboard in headless mode, so 0 is returned there
+ * when queue is empty.
+ */
+static int nextKeyEvent(BGI_EVENT * event)
+{
+  for(;;)
+  {
+    while(BGI_getEvent(event))
+      if(event->type == BGI_EVENT_KEY)
+        return 1;
+    if(window.mode & MODE_HEADLESS)
+      return 0;
+#ifdef _WIN32
+    IPC_waitEvent(sharedObjects.keyboardEvent);
+#endif
+  }
+}
+
+int BGI_waitForKeyPressed(void)
+{
+  BGI_EVENT event;
+  if(!nextKeyEvent(&event))
+    return KEY_ESCAPE;
+  return event.key != 0 ? event.key : event.letter;
+}
+
 int BGI_getch()
 {
   static int lastKey = -1;
+  BGI_EVENT event;
   int c;
 
+  /* special keys are returned as 0 followed by key code */
   if(lastKey != -1)
   {
     c = lastKey;
     lastKey = -1;
-    SendMessage(window.wnd, WM_KEYPROCESSED, 0, 0);
-    return translateKeyCode(c);
+    return c;
   }
 
-  IPC_waitEvent(sharedObjects.keyboardEvent);
+  if(!nextKeyEvent(&event))
+    return KEY_ESCAPE;
 
-  if(sharedStruct->keyCode > 0)
+  if(event.key > 0)
   {
-    lastKey = sharedStruct->keyCode;
+    lastKey = event.key;
     return 0;
   }
-
-  c = sharedStruct->keyLetter;
-  SendMessage(window.wnd, WM_KEYPROCESSED, 0, 0);
-  return c;
+  return event.letter;
 }
 
 void BGI_closeWindow()
 {
+  if(window.mode & MODE_HEADLESS)
+  {
+    closeHeadless();
+    return;
+  }
+#ifdef _WIN32
+  if(window.mode & MODE_PIPELINE)
+    RENDER_stopRecording();
   if(serverCheckerThread != NULL)
     TerminateThread(serverCheckerThread, 0);
   SendMessage(window.wnd, WM_DESTROY, 0, 0);
   BGI_closeSharedObjects(&sharedObjects, sharedStruct);
+#endif
 }
-
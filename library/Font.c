@@ -0,0 +1,368 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Font.h"
+#include "BGI.H"
+#include "graphics.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Sizes and directions whose scaled strokes are kept */
+#define FONT_CACHE_ENTRIES 8
+#define FONT_PATH_SIZE 260
+#define FONT_CHARS 256
+/* Ints in line record of RASTER_BATCH_LINES without color */
+#define SEGMENT_INTS 4
+
+/* Font file read into memory, pointers are inside data */
+typedef struct
+{
+  unsigned char * data;
+  size_t size;
+  int first, count;
+  int top, bottom;
+  const unsigned char * offsets;
+  const unsigned char * widths;
+  const unsigned char * strokes;
+  size_t strokesSize;
+} FONT_FILE;
+
+/**
+ * Strokes of font scaled for one style: segments (x1, y1, x2, y2) of
+ * every character are relative to its pen position. Character is scaled
+ * when it is used first time (start is -1 before that).
+ */
+typedef struct
+{
+  FONT_STYLE style;
+  int valid;
+  int * segments;
+  int used, allocated;
+  int start[FONT_CHARS], count[FONT_CHARS];
+  int advance[FONT_CHARS];
+} FONT_SCALED;
+
+/* File names of fonts from TRIPLEX_FONT */
+static const char * fileNames[BOLD_FONT] =
+{
+  "TRIP", "LITT", "SANS", "GOTH", "SCRI", "SIMP", "TSCR", "LCOM", "EURO", "BOLD"
+};
+
+static char fontPath[FONT_PATH_SIZE];
+static FONT_FILE files[BOLD_FONT + 1];
+static FONT_SCALED cache[FONT_CACHE_ENTRIES];
+/* Entry that is replaced next */
+static int nextEntry;
+/* Records of last FONT_lines */
+static int * lines;
+static int linesAllocated;
+
+void FONT_setPath(const char * path)
+{
+  strncpy(fontPath, path, FONT_PATH_SIZE - 1);
+  fontPath[FONT_PATH_SIZE - 1] = 0;
+}
+
+static int word(const unsigned char * p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+/* Returns 0 if file is not a stroked font */
+static int parseFont(FONT_FILE * file)
+{
+  const unsigned char * d = file->data, * header;
+  size_t i, headerSize, strokeOffset;
+  if(file->size < 4 || memcmp(d, "PK\x08\x08", 4) != 0)
+    return 0;
+  for(i = 4; i != file->size && d[i] != 0x1A; i++)
+    ;
+  if(i + 3 > file->size)
+    return 0;
+  headerSize = word(d + i + 1);
+  if(headerSize + 16 > file->size)
+    return 0;
+  header = d + headerSize;
+  if(header[0] != '+')
+    return 0;
+  file->count = word(header + 1);
+  file->first = header[4];
+  strokeOffset = word(header + 5);
+  file->top = (signed char)header[8];
+  file->bottom = (signed char)header[10];
+  if(16 + 3 * (size_t)file->count > strokeOffset || headerSize + strokeOffset > file->size)
+    return 0;
+  file->offsets = header + 16;
+  file->widths = file->offsets + 2 * file->count;
+  file->strokes = header + strokeOffset;
+  file->strokesSize = file->size - headerSize - strokeOffset;
+  return 1;
+}
+
+/* Returns NULL if there is no such file, name is tried in upper and lower case */
+static FILE * openFont(int font)
+{
+  char name[FONT_PATH_SIZE + 16];
+  const char * separator;
+  FILE * f = NULL;
+  int i, lower;
+  size_t length = strlen(fontPath);
+  separator = length == 0 || fontPath[length - 1] == '/' || fontPath[length - 1] == '\\' ? "" : "/";
+  for(i = 0; i != 4 && f == NULL; i++)
+  {
+    /* directory of initgraph first, then current one */
+    lower = i & 1;
+    if(i < 2)
+      sprintf(name, "%s%s%s.%s", fontPath, separator, fileNames[font - 1], "CHR");
+    else
+      sprintf(name, "%s.%s", fileNames[font - 1], "CHR");
+    if(lower)
+    {
+      for(length = strlen(name) - 8; name[length] != 0; length++)
+        name[length] = (char)tolower((unsigned char)name[length]);
+    }
+    f = fopen(name, "rb");
+  }
+  return f;
+}
+
+int FONT_load(int font)
+{
+  FONT_FILE * file = files + font;
+  FILE * f;
+  long size;
+  if(font <= DEFAULT_FONT || font > BOLD_FONT)
+    return grInvalidFontNum;
+  if(file->data != NULL)
+    return grOk;
+  f = openFont(font);
+  if(f == NULL)
+    return grFontNotFound;
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  file->data = size > 0 ? BGI_malloc((int)size) : NULL;
+  if(file->data == NULL)
+  {
+    fclose(f);
+    return size > 0 ? grNoFontMem : grInvalidFont;
+  }
+  file->size = fread(file->data, 1, (size_t)size, f);
+  fclose(f);
+  if(!parseFont(file))
+  {
+    BGI_free(file->data);
+    file->data = NULL;
+    return grInvalidFont;
+  }
+  return grOk;
+}
+
+void FONT_free(void)
+{
+  int i;
+  for(i = 0; i <= BOLD_FONT; i++)
+  {
+    BGI_free(files[i].data);
+    files[i].data = NULL;
+  }
+  for(i = 0; i != FONT_CACHE_ENTRIES; i++)
+  {
+    free(cache[i].segments);
+    cache[i].segments = NULL;
+    cache[i].allocated = 0;
+    cache[i].valid = 0;
+  }
+  free(lines);
+  lines = NULL;
+  linesAllocated = 0;
+}
+
+/* Grows array of ints twice until count fits, returns 0 if there is no memory */
+static int growInts(int ** array, int * allocated, int count)
+{
+  int size = *allocated != 0 ? *allocated : 256;
+  int * grown;
+  if(count <= *allocated)
+    return 1;
+  while(size < count)
+    size *= 2;
+  grown = realloc(*array, size * sizeof(int));
+  if(grown == NULL)
+    return 0;
+  *array = grown;
+  *allocated = size;
+  return 1;
+}
+
+static int scale(int value, double factor)
+{
+  return (int)floor(value * factor + 0.5);
+}
+
+/* Point of character in pixels relative to pen, vertical text is turned counterclockwise */
+static void scalePoint(const FONT_SCALED * scaled, int top, int x, int y, int * px, int * py)
+{
+  if(scaled->style.vertical)
+  {
+    *px = scale(top - y, scaled->style.sy);
+    *py = -scale(x, scaled->style.sx);
+  }
+  else
+  {
+    *px = scale(x, scaled->style.sx);
+    *py = scale(top - y, scaled->style.sy);
+  }
+}
+
+/* Scales strokes of character c, returns 0 if there is no memory */
+static int scaleChar(FONT_SCALED * scaled, int c)
+{
+  const FONT_FILE * file = files + scaled->style.font;
+  int index = c - file->first, x, y, px = 0, py = 0, nx, ny, * s;
+  size_t offset;
+  scaled->start[c] = scaled->used;
+  scaled->count[c] = 0;
+  scaled->advance[c] = 0;
+  /* characters that are not in font are not drawn */
+  if(index < 0 || index >= file->count)
+    return 1;
+  scaled->advance[c] = scale(file->widths[index], scaled->style.sx);
+  for(offset = word(file->offsets + 2 * index); offset + 2 <= file->strokesSize; offset += 2)
+  {
+    /* operation is in high bits, coordinates are signed 7-bit numbers */
+    x = file->strokes[offset] & 0x7F;
+    y = file->strokes[offset + 1] & 0x7F;
+    x = x & 0x40 ? x - 0x80 : x;
+    y = y & 0x40 ? y - 0x80 : y;
+    if((file->strokes[offset] & 0x80) == 0)
+    {
+      if((file->strokes[offset + 1] & 0x80) == 0)
+        break;
+      continue;
+    }
+    scalePoint(scaled, file->top, x, y, &nx, &ny);
+    if(file->strokes[offset + 1] & 0x80)
+    {
+      if(!growInts(&scaled->segments, &scaled->allocated, scaled->used + SEGMENT_INTS))
+        return 0;
+      s = scaled->segments + scaled->used;
+      s[0] = px;
+      s[1] = py;
+      s[2] = nx;
+      s[3] = ny;
+      scaled->used += SEGMENT_INTS;
+      scaled->count[c]++;
+    }
+    px = nx;
+    py = ny;
+  }
+  return 1;
+}
+
+/* Returns cache entry of style, oldest entry is replaced if style is not cached */
+static FONT_SCALED * scaledFont(const FONT_STYLE * style)
+{
+  FONT_SCALED * scaled;
+  int i;
+  for(i = 0; i != FONT_CACHE_ENTRIES; i++)
+  {
+    scaled = cache + i;
+    if(scaled->valid && scaled->style.font == style->font && scaled->style.sx == style->sx &&
+       scaled->style.sy == style->sy && scaled->style.vertical == style->vertical)
+      return scaled;
+  }
+  scaled = cache + nextEntry;
+  nextEntry = (nextEntry + 1) % FONT_CACHE_ENTRIES;
+  scaled->style = *style;
+  scaled->valid = 1;
+  scaled->used = 0;
+  for(i = 0; i != FONT_CHARS; i++)
+    scaled->start[i] = -1;
+  return scaled;
+}
+
+/* Returns 0 if there is no memory */
+static int prepareText(FONT_SCALED * scaled, const char * text)
+{
+  int c;
+  for(; *text != 0; text++)
+  {
+    c = (unsigned char)*text;
+    if(scaled->start[c] == -1 && !scaleChar(scaled, c))
+    {
+      scaled->start[c] = -1;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int FONT_width(const FONT_STYLE * style, const char * text)
+{
+  FONT_SCALED * scaled = scaledFont(style);
+  int width = 0;
+  if(!prepareText(scaled, text))
+    return 0;
+  for(; *text != 0; text++)
+    width += scaled->advance[(unsigned char)*text];
+  return width;
+}
+
+int FONT_height(const FONT_STYLE * style)
+{
+  return scale(files[style->font].top - files[style->font].bottom, style->sy);
+}
+
+const int * FONT_lines(const FONT_STYLE * style, const char * text, int x, int y, int color, int * count)
+{
+  FONT_SCALED * scaled = scaledFont(style);
+  const int * s, * end;
+  int c, n = 0, * r;
+  *count = 0;
+  if(!prepareText(scaled, text))
+    return NULL;
+  for(; *text != 0; text++)
+  {
+    c = (unsigned char)*text;
+    if(!growInts(&lines, &linesAllocated, (n + scaled->count[c]) * (SEGMENT_INTS + 1)))
+      return NULL;
+    r = lines + n * (SEGMENT_INTS + 1);
+    end = scaled->segments + scaled->start[c] + scaled->count[c] * SEGMENT_INTS;
+    for(s = scaled->segments + scaled->start[c]; s != end; s += SEGMENT_INTS, r += SEGMENT_INTS + 1)
+    {
+      r[0] = x + s[0];
+      r[1] = y + s[1];
+      r[2] = x + s[2];
+      r[3] = y + s[3];
+      r[4] = color;
+    }
+    n += scaled->count[c];
+    /* pen goes right, or up for vertical text */
+    if(style->vertical)
+      y -= scaled->advance[c];
+    else
+      x += scaled->advance[c];
+  }
+  *count = n;
+  return lines;
+}
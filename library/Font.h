@@ -0,0 +1,65 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FONT_H__
+#define __FONT_H__
+
+/**
+ * Stroked fonts (TRIPLEX_FONT..BOLD_FONT) of Borland .CHR files. File is
+ * read from directory given to initgraph or from current directory when
+ * font is selected first time. Strokes of characters are scaled for
+ * size and direction when they are drawn first time and kept in cache,
+ * text is drawn as lines in pixels (records of RASTER_BATCH_LINES).
+ *
+ * .CHR file: "PK\x08\x08", description ended by 0x1A, 16-bit offset of
+ * font header. Font header: '+', 16-bit number of characters, byte,
+ * first character, 16-bit offset of strokes (from header), byte,
+ * signed distances from baseline to top of capitals, to baseline and to
+ * bottom of descenders, 5 bytes. Then 16-bit offsets of characters (from
+ * strokes), widths of characters (bytes) and strokes: two bytes with
+ * signed 7-bit x and y (up) and high bits of operation: 00 - end of
+ * character, 10 - move to point, 11 - draw line to point.
+ */
+
+/* Font, scale from font units to pixels and direction */
+typedef struct
+{
+  int font;
+  double sx, sy;
+  int vertical;
+} FONT_STYLE;
+
+/* Directory of .CHR files, copied */
+void FONT_setPath(const char * path);
+/* Reads font if it is not read yet, returns grOk, grFontNotFound, grInvalidFont or grNoFontMem */
+int FONT_load(int font);
+/* Frees fonts and cache */
+void FONT_free(void);
+/* Length of text along its direction in pixels */
+int FONT_width(const FONT_STYLE * style, const char * text);
+/* Height of characters (from top of capitals to bottom of descenders) in pixels */
+int FONT_height(const FONT_STYLE * style);
+/**
+ * Returns count line records (x1, y1, x2, y2, color) of text with top
+ * left corner at (x, y), or bottom left one for vertical text. Records
+ * are valid until next call, NULL is returned if there is no memory.
+ */
+const int * FONT_lines(const FONT_STYLE * style, const char * text, int x, int y, int color, int * count);
+
+#endif
@@ -20,12 +20,14 @@
 #ifndef __IPC_H__
 #define __IPC_H__
 
-#include <windows.h>
+#include "Platform.h"
 
 /**
  * Wrappers around windows events API. Written just for more
- * meaning names.
+ * meaning names. IPC.C implements them with Win32, IPCPosix.c
+ * with shm_open, futexes and process-shared pthread mutexes.
  */
+/* name may be NULL, then event can be used only inside current process */
 HANDLE IPC_createEvent(const char * name);
 HANDLE IPC_openEvent(const char * name);
 HANDLE IPC_createMutex(const char * name, int owned);
@@ -35,6 +37,15 @@ void IPC_unlockMutex(HANDLE mutex);
 
 void IPC_raiseEvent(HANDLE event);
 void IPC_waitEvent(HANDLE event);
+/* Closes event, mutex or section */
+void IPC_closeObject(HANDLE object);
+
+/* Runs proc(param) in new thread of current process */
+HANDLE IPC_startThread(void (*proc)(void * param), void * param);
+/* Waits until thread is finished and closes it */
+void IPC_joinThread(HANDLE thread);
+/* Milliseconds of wall clock that is not set back, from unspecified point, wraps around */
+unsigned IPC_milliseconds(void);
 
 /**
  * Wrappers around windows inter process memory sharing API
@@ -0,0 +1,402 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * POSIX implementation of IPC.h. Every named object is a shm_open`ed
+ * file mapped into both processes. Events are futexes (on linux) so
+ * waiting process is woken up by kernel right after IPC_raiseEvent,
+ * mutexes are robust process-shared pthread mutexes, so like in Win32
+ * mutex of died process can be locked (that is how presence of
+ * client and server is checked).
+ */
+
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE
+#endif
+
+#include "IPC.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+#ifdef __linux__
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+#endif
+
+#define IPC_NAME_SIZE 64
+
+/* Auto-reset event that lives in shared memory */
+typedef struct
+{
+  int signaled;
+  int waiters;
+#ifndef __linux__
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+#endif
+} IPC_EVENT;
+
+/* What HANDLE points to */
+typedef struct
+{
+  char name[IPC_NAME_SIZE];
+  int fd;
+  int created;
+  size_t size;
+  /* shared IPC_EVENT or pthread_mutex_t, NULL for sections */
+  void * addr;
+} IPC_OBJECT;
+
+/* Memory mapped by IPC_createSharedMemory/IPC_openSharedMemory */
+typedef struct IPC_VIEW
+{
+  void * addr;
+  size_t size;
+  HANDLE section;
+  struct IPC_VIEW * next;
+} IPC_VIEW;
+
+static IPC_VIEW * views = NULL;
+static pthread_mutex_t viewsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Opens (or creates if size != 0) shared memory object with given name */
+static IPC_OBJECT * openObject(const char * name, size_t size)
+{
+  IPC_OBJECT * obj = malloc(sizeof(IPC_OBJECT));
+  struct stat st;
+  assert(obj != NULL);
+  snprintf(obj->name, sizeof(obj->name), "/%s", name);
+  obj->created = 0;
+  obj->addr = NULL;
+  obj->fd = -1;
+  if(size != 0)
+  {
+    obj->fd = shm_open(obj->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(obj->fd != -1)
+    {
+      obj->created = 1;
+      if(ftruncate(obj->fd, (off_t)size) != 0)
+      {
+        close(obj->fd);
+        shm_unlink(obj->name);
+        obj->fd = -1;
+      }
+    }
+  }
+  /* object exists, Win32 create functions just open it in that case */
+  if(obj->fd == -1)
+    obj->fd = shm_open(obj->name, O_RDWR, 0600);
+  if(obj->fd == -1 || fstat(obj->fd, &st) != 0)
+  {
+    if(obj->fd != -1)
+      close(obj->fd);
+    free(obj);
+    return NULL;
+  }
+  obj->size = (size_t)st.st_size;
+  return obj;
+}
+
+static IPC_OBJECT * openMappedObject(const char * name, size_t size)
+{
+  IPC_OBJECT * obj;
+  /* unnamed object is used by threads of one process only */
+  if(name == NULL)
+  {
+    obj = malloc(sizeof(IPC_OBJECT));
+    assert(obj != NULL);
+    obj->name[0] = 0;
+    obj->fd = -1;
+    obj->created = 1;
+    obj->size = size;
+    obj->addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(obj->addr == MAP_FAILED)
+    {
+      IPC_closeObject(obj);
+      return NULL;
+    }
+    return obj;
+  }
+  obj = openObject(name, size);
+  if(obj == NULL)
+    return NULL;
+  obj->addr = mmap(NULL, obj->size, PROT_READ | PROT_WRITE, MAP_SHARED, obj->fd, 0);
+  if(obj->addr == MAP_FAILED)
+  {
+    IPC_closeObject(obj);
+    return NULL;
+  }
+  return obj;
+}
+
+#ifdef __linux__
+
+static void futexWait(int * addr, int value)
+{
+  syscall(SYS_futex, addr, FUTEX_WAIT, value, NULL, NULL, 0);
+}
+
+static void futexWake(int * addr, int count)
+{
+  syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+#endif
+
+HANDLE IPC_createEvent(const char * name)
+{
+  IPC_OBJECT * obj = openMappedObject(name, sizeof(IPC_EVENT));
+  IPC_EVENT * event;
+  if(obj == NULL || !obj->created)
+    return obj;
+  event = obj->addr;
+  event->signaled = 0;
+  event->waiters = 0;
+#ifndef __linux__
+  {
+    pthread_mutexattr_t ma;
+    pthread_condattr_t ca;
+    pthread_mutexattr_init(&ma);
+    pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&event->lock, &ma);
+    pthread_mutexattr_destroy(&ma);
+    pthread_condattr_init(&ca);
+    pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&event->cond, &ca);
+    pthread_condattr_destroy(&ca);
+  }
+#endif
+  return obj;
+}
+
+HANDLE IPC_openEvent(const char * name)
+{
+  return openMappedObject(name, 0);
+}
+
+HANDLE IPC_createMutex(const char * name, int owned)
+{
+  IPC_OBJECT * obj = openMappedObject(name, sizeof(pthread_mutex_t));
+  pthread_mutexattr_t attr;
+  if(obj == NULL)
+    return NULL;
+  if(obj->created)
+  {
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(obj->addr, &attr);
+    pthread_mutexattr_destroy(&attr);
+  }
+  if(owned)
+    IPC_lockMutex(obj);
+  return obj;
+}
+
+HANDLE IPC_openMutex(const char * name)
+{
+  return openMappedObject(name, 0);
+}
+
+void IPC_raiseEvent(HANDLE handle)
+{
+  IPC_EVENT * event = ((IPC_OBJECT *)handle)->addr;
+#ifdef __linux__
+  __atomic_store_n(&event->signaled, 1, __ATOMIC_SEQ_CST);
+  /* syscall is needed only if somebody sleeps */
+  if(__atomic_load_n(&event->waiters, __ATOMIC_SEQ_CST) != 0)
+    futexWake(&event->signaled, 1);
+#else
+  pthread_mutex_lock(&event->lock);
+  event->signaled = 1;
+  if(event->waiters != 0)
+    pthread_cond_signal(&event->cond);
+  pthread_mutex_unlock(&event->lock);
+#endif
+}
+
+void IPC_waitEvent(HANDLE handle)
+{
+  IPC_EVENT * event = ((IPC_OBJECT *)handle)->addr;
+#ifdef __linux__
+  int expected;
+  for(;;)
+  {
+    expected = 1;
+    if(__atomic_compare_exchange_n(&event->signaled, &expected, 0, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+      return;
+    __atomic_add_fetch(&event->waiters, 1, __ATOMIC_SEQ_CST);
+    /* returns at once if event was raised after compare_exchange */
+    futexWait(&event->signaled, 0);
+    __atomic_sub_fetch(&event->waiters, 1, __ATOMIC_SEQ_CST);
+  }
+#else
+  pthread_mutex_lock(&event->lock);
+  event->waiters++;
+  while(!event->signaled)
+    pthread_cond_wait(&event->cond, &event->lock);
+  event->waiters--;
+  event->signaled = 0;
+  pthread_mutex_unlock(&event->lock);
+#endif
+}
+
+void IPC_lockMutex(HANDLE mutex)
+{
+  pthread_mutex_t * m = ((IPC_OBJECT *)mutex)->addr;
+  /* owner has died: mutex is abandoned, as in Win32 we get it anyway */
+  if(pthread_mutex_lock(m) == EOWNERDEAD)
+    pthread_mutex_consistent(m);
+}
+
+void IPC_unlockMutex(HANDLE mutex)
+{
+  pthread_mutex_unlock(((IPC_OBJECT *)mutex)->addr);
+}
+
+void IPC_closeObject(HANDLE handle)
+{
+  IPC_OBJECT * obj = handle;
+  if(obj == NULL)
+    return;
+  if(obj->addr != NULL && obj->addr != MAP_FAILED)
+    munmap(obj->addr, obj->size);
+  if(obj->fd != -1)
+    close(obj->fd);
+  /* name disappears, but objects live while they are mapped somewhere */
+  if(obj->created && obj->name[0] != 0)
+    shm_unlink(obj->name);
+  free(obj);
+}
+
+typedef struct
+{
+  pthread_t thread;
+  void (*proc)(void * param);
+  void * param;
+} IPC_THREAD;
+
+static void * threadProc(void * p)
+{
+  IPC_THREAD * thread = p;
+  thread->proc(thread->param);
+  return NULL;
+}
+
+HANDLE IPC_startThread(void (*proc)(void * param), void * param)
+{
+  IPC_THREAD * thread = malloc(sizeof(IPC_THREAD));
+  assert(thread != NULL);
+  thread->proc = proc;
+  thread->param = param;
+  if(pthread_create(&thread->thread, NULL, threadProc, thread) != 0)
+  {
+    free(thread);
+    return NULL;
+  }
+  return thread;
+}
+
+void IPC_joinThread(HANDLE handle)
+{
+  IPC_THREAD * thread = handle;
+  pthread_join(thread->thread, NULL);
+  free(thread);
+}
+
+unsigned IPC_milliseconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned)ts.tv_sec * 1000 + (unsigned)(ts.tv_nsec / 1000000);
+}
+
+HANDLE IPC_createSection(const char * name, int size)
+{
+  return openObject(name, (size_t)size);
+}
+
+HANDLE IPC_openSection(const char * name)
+{
+  return openObject(name, 0);
+}
+
+static void * mapSection(HANDLE section)
+{
+  IPC_OBJECT * obj = section;
+  IPC_VIEW * view;
+  void * addr;
+  if(obj == NULL)
+    return NULL;
+  addr = mmap(NULL, obj->size, PROT_READ | PROT_WRITE, MAP_SHARED, obj->fd, 0);
+  if(addr == MAP_FAILED)
+  {
+    IPC_closeObject(obj);
+    return NULL;
+  }
+  view = malloc(sizeof(IPC_VIEW));
+  assert(view != NULL);
+  view->addr = addr;
+  view->size = obj->size;
+  view->section = obj;
+  pthread_mutex_lock(&viewsLock);
+  view->next = views;
+  views = view;
+  pthread_mutex_unlock(&viewsLock);
+  return addr;
+}
+
+void * IPC_createSharedMemory(const char * name, int size)
+{
+  return mapSection(IPC_createSection(name, size));
+}
+
+void * IPC_openSharedMemory(const char * name)
+{
+  return mapSection(IPC_openSection(name));
+}
+
+void IPC_closeSharedMemory(void * addr)
+{
+  IPC_VIEW ** p, * view = NULL;
+  pthread_mutex_lock(&viewsLock);
+  for(p = &views; *p != NULL; p = &(*p)->next)
+  {
+    if((*p)->addr == addr)
+    {
+      view = *p;
+      *p = view->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&viewsLock);
+  if(view == NULL)
+    return;
+  munmap(view->addr, view->size);
+  IPC_closeObject(view->section);
+  free(view);
+}
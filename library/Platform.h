@@ -0,0 +1,62 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __PLATFORM_H__
+#define __PLATFORM_H__
+
+/**
+ * Includes windows.h on Win32. Everywhere else declares only those
+ * Win32 types that are part of shared structures, so the headless
+ * backend can be built without Win32 at all.
+ */
+#ifdef _WIN32
+
+#ifndef _MSC_VER
+  #define _WIN_VER 0x500
+#endif
+#include <windows.h>
+
+#else
+
+#include <stddef.h>
+
+#ifndef TRUE
+  #define TRUE 1
+  #define FALSE 0
+#endif
+
+typedef void * HANDLE;
+typedef HANDLE HDC;
+typedef HANDLE HWND;
+typedef HANDLE HBITMAP;
+typedef HANDLE HINSTANCE;
+typedef unsigned char BYTE;
+typedef unsigned long DWORD;
+
+typedef struct
+{
+  BYTE rgbBlue;
+  BYTE rgbGreen;
+  BYTE rgbRed;
+  BYTE rgbReserved;
+} RGBQUAD;
+
+#endif
+
+#endif
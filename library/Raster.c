@@ -0,0 +1,2069 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Raster.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INSIDE(CTX, X, Y) \
+  ((X) >= (CTX)->clipLeft && (X) <= (CTX)->clipRight && \
+   (Y) >= (CTX)->clipTop && (Y) <= (CTX)->clipBottom)
+
+/* Bounding box of primitive against clip rectangle, see clipBox */
+#define CLIP_OUTSIDE 0
+#define CLIP_CROSSES 1
+#define CLIP_INSIDE 2
+
+/* Decision values of ellipses do not fit into 32 bits */
+#ifdef _MSC_VER
+typedef __int64 RASTER_INT64;
+typedef unsigned __int64 RASTER_UINT64;
+#else
+typedef long long RASTER_INT64;
+typedef unsigned long long RASTER_UINT64;
+#endif
+
+/* sin of 0..90 degrees, 16.16 fixed point */
+static const int sinTable[91] =
+{
+  0, 1144, 2287, 3430, 4572, 5712, 6850, 7987, 9121, 10252,
+  11380, 12505, 13626, 14742, 15855, 16962, 18064, 19161, 20252, 21336,
+  22415, 23486, 24550, 25607, 26656, 27697, 28729, 29753, 30767, 31772,
+  32768, 33754, 34729, 35693, 36647, 37590, 38521, 39441, 40348, 41243,
+  42126, 42995, 43852, 44695, 45525, 46341, 47143, 47930, 48703, 49461,
+  50203, 50931, 51643, 52339, 53020, 53684, 54332, 54963, 55578, 56175,
+  56756, 57319, 57865, 58393, 58903, 59396, 59870, 60326, 60764, 61183,
+  61584, 61966, 62328, 62672, 62997, 63303, 63589, 63856, 64104, 64332,
+  64540, 64729, 64898, 65048, 65177, 65287, 65376, 65446, 65496, 65526,
+  65536
+};
+
+/* 8x8 font for characters 0x20..0x7F, bit 0 is the leftmost pixel */
+static const unsigned char font8x8[96][8] =
+{
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00},
+  {0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00},
+  {0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00},
+  {0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00},
+  {0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00},
+  {0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00},
+  {0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00},
+  {0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00},
+  {0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06},
+  {0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00},
+  {0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00},
+  {0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00},
+  {0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00},
+  {0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00},
+  {0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00},
+  {0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00},
+  {0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00},
+  {0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00},
+  {0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00},
+  {0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00},
+  {0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00},
+  {0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00},
+  {0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06},
+  {0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00},
+  {0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00},
+  {0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00},
+  {0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00},
+  {0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00},
+  {0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00},
+  {0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00},
+  {0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00},
+  {0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00},
+  {0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00},
+  {0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00},
+  {0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00},
+  {0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00},
+  {0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},
+  {0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00},
+  {0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00},
+  {0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00},
+  {0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00},
+  {0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00},
+  {0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00},
+  {0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00},
+  {0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00},
+  {0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00},
+  {0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00},
+  {0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},
+  {0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00},
+  {0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00},
+  {0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00},
+  {0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00},
+  {0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00},
+  {0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00},
+  {0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00},
+  {0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00},
+  {0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00},
+  {0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF},
+  {0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00},
+  {0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00},
+  {0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00},
+  {0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00},
+  {0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00},
+  {0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00},
+  {0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F},
+  {0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00},
+  {0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},
+  {0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E},
+  {0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00},
+  {0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},
+  {0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00},
+  {0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00},
+  {0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00},
+  {0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F},
+  {0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78},
+  {0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00},
+  {0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00},
+  {0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00},
+  {0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00},
+  {0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00},
+  {0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00},
+  {0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00},
+  {0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F},
+  {0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00},
+  {0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00},
+  {0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00},
+  {0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00},
+  {0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+};
+
+int RASTER_stride(int width, int bpp)
+{
+  return ((width * bpp + 31) / 32) * 4;
+}
+
+void RASTER_initSurface(RASTER_SURFACE * surface, void * bits, int width, int height, int bpp)
+{
+  surface->bits = (unsigned char *)bits;
+  surface->width = width;
+  surface->height = height;
+  surface->bpp = bpp;
+  surface->stride = RASTER_stride(width, bpp);
+}
+
+void * RASTER_reserve(RASTER_SCRATCH * scratch, size_t size)
+{
+  if(size > scratch->size)
+  {
+    /* content is not kept, so there is nothing to copy */
+    free(scratch->data);
+    scratch->size = 0;
+    scratch->data = malloc(size);
+    if(scratch->data == NULL)
+      return NULL;
+    scratch->size = size;
+  }
+  return scratch->data;
+}
+
+void * RASTER_grow(RASTER_SCRATCH * scratch, size_t size)
+{
+  void * data;
+  if(size > scratch->size)
+  {
+    /* scratch is kept if there is no memory */
+    data = realloc(scratch->data, size);
+    if(data == NULL)
+      return NULL;
+    scratch->data = data;
+    scratch->size = size;
+  }
+  return scratch->data;
+}
+
+void RASTER_freeScratch(RASTER_SCRATCH * scratch)
+{
+  free(scratch->data);
+  scratch->data = NULL;
+  scratch->size = 0;
+}
+
+/* Scratch of context, or local one if context has none (it must be freed by caller) */
+static void * reserve(const RASTER_CONTEXT * ctx, RASTER_SCRATCH * local, size_t size)
+{
+  return RASTER_reserve(ctx->scratch != NULL ? ctx->scratch : local, size);
+}
+
+/* Rows are stored bottom-up */
+static unsigned char * rowOf(const RASTER_SURFACE * surface, int y)
+{
+  return surface->bits + (surface->height - y - 1) * surface->stride;
+}
+
+/* Bits of pixel value */
+static unsigned pixelMask(int bpp)
+{
+  return bpp == 32 ? 0xFFFFFF : (1u << bpp) - 1;
+}
+
+/* Combines pixel with color by operation other than COPY and XOR */
+static unsigned applyOp(unsigned pixel, unsigned color, int op, unsigned mask)
+{
+  switch(op)
+  {
+  case RASTER_OR:
+    return pixel | color;
+  case RASTER_AND:
+    return pixel & color;
+  case RASTER_NOT:
+    return color ^ mask;
+  }
+  return color;
+}
+
+static void plotInRow(const RASTER_SURFACE * surface, unsigned char * row, int x, unsigned color, int op)
+{
+  if(surface->bpp == 32)
+  {
+    unsigned * p = (unsigned *)row + x;
+    if(op == RASTER_XOR)
+      *p ^= color;
+    else if(op == RASTER_COPY)
+      *p = color;
+    else
+      *p = applyOp(*p, color, op, 0xFFFFFF);
+  }
+  else if(surface->bpp == 16)
+  {
+    unsigned short * p = (unsigned short *)row + x;
+    if(op == RASTER_XOR)
+      *p ^= (unsigned short)color;
+    else if(op == RASTER_COPY)
+      *p = (unsigned short)color;
+    else
+      *p = (unsigned short)applyOp(*p, color, op, 0xFFFF);
+  }
+  else if(surface->bpp == 8)
+  {
+    unsigned char * p = row + x;
+    if(op == RASTER_XOR)
+      *p ^= (unsigned char)color;
+    else if(op == RASTER_COPY)
+      *p = (unsigned char)color;
+    else
+      *p = (unsigned char)applyOp(*p, color, op, 0xFF);
+  }
+  else
+  {
+    unsigned char * p = row + (x >> 1);
+    int delta = x & 1 ? 0 : 4;
+    if(op == RASTER_XOR)
+      *p ^= (unsigned char)((color & 0xF) << delta);
+    else
+    {
+      if(op != RASTER_COPY)
+        color = applyOp((*p >> delta) & 0xF, color, op, 0xF);
+      *p = (unsigned char)((*p & (0xF0 >> delta)) | ((color & 0xF) << delta));
+    }
+  }
+}
+
+static void plot(const RASTER_SURFACE * surface, int x, int y, unsigned color, int op)
+{
+  plotInRow(surface, rowOf(surface, y), x, color, op);
+}
+
+static unsigned fetch(const RASTER_SURFACE * surface, int x, int y)
+{
+  unsigned char * row = rowOf(surface, y);
+  if(surface->bpp == 32)
+    return ((unsigned *)row)[x];
+  if(surface->bpp == 16)
+    return ((unsigned short *)row)[x];
+  if(surface->bpp == 8)
+    return row[x];
+  return (row[x >> 1] >> (x & 1 ? 0 : 4)) & 0xF;
+}
+
+/* Expands 8 pixels (bit 0x80 is the first one) to span pattern, colors are chosen by set and cleared bits */
+static void expandRow(int bpp, unsigned bits, unsigned set, unsigned cleared, unsigned char * pattern)
+{
+  int i;
+  unsigned color, next;
+  unsigned short pixel16;
+  for(i = 0; i != SPAN_PERIOD; i++)
+  {
+    if(bpp == 32)
+    {
+      /* pixel is stored as unsigned, like plot does */
+      if(i % 4 == 0)
+      {
+        color = bits & (0x80 >> (i / 4)) ? set : cleared;
+        memcpy(pattern + i, &color, 4);
+      }
+    }
+    else if(bpp == 16)
+    {
+      /* period is 16 pixels, pattern row is repeated twice */
+      if(i % 2 == 0)
+      {
+        color = bits & (0x80 >> (i / 2 % 8)) ? set : cleared;
+        pixel16 = (unsigned short)color;
+        memcpy(pattern + i, &pixel16, 2);
+      }
+    }
+    else if(bpp == 8)
+      pattern[i] = (unsigned char)(bits & (0x80 >> (i % 8)) ? set : cleared);
+    else
+    {
+      /* even pixel is in high nibble, 8 pixels are 4 bytes */
+      color = bits & (0x80 >> (i % 4 * 2)) ? set : cleared;
+      next = bits & (0x40 >> (i % 4 * 2)) ? set : cleared;
+      pattern[i] = (unsigned char)(((color & 0xF) << 4) | (next & 0xF));
+    }
+  }
+  memcpy(pattern + SPAN_PERIOD, pattern, SPAN_PERIOD);
+}
+
+void RASTER_expandFill(RASTER_CONTEXT * ctx)
+{
+  int i, j;
+  for(i = 0; i != 8; i++)
+  {
+    /* rows of most patterns repeat (all of them for solid fill), they are expanded once */
+    for(j = 0; j != i && ctx->fillPattern[j] != ctx->fillPattern[i]; j++)
+      ;
+    if(j != i)
+      memcpy(ctx->fillRows[i], ctx->fillRows[j], sizeof(ctx->fillRows[i]));
+    else
+      expandRow(ctx->surface.bpp, ctx->fillPattern[i], ctx->fillColor, ctx->backColor, ctx->fillRows[i]);
+  }
+}
+
+/* Span [x1, x2] of row in surface coordinates filled with span pattern, it is inside surface */
+static void fillSpan(const RASTER_SURFACE * surface, int y, int x1, int x2, const unsigned char * pattern)
+{
+  unsigned char * row = rowOf(surface, y);
+  if(surface->bpp == 32)
+  {
+    SPAN_fill(row + x1 * 4, (x2 - x1 + 1) * 4, pattern, x1 * 4);
+    return;
+  }
+  if(surface->bpp == 16)
+  {
+    SPAN_fill(row + x1 * 2, (x2 - x1 + 1) * 2, pattern, x1 * 2);
+    return;
+  }
+  if(surface->bpp == 8)
+  {
+    SPAN_fill(row + x1, x2 - x1 + 1, pattern, x1);
+    return;
+  }
+  /* odd first and even last pixels share bytes with pixels that are not filled */
+  if(x1 & 1)
+  {
+    plotInRow(surface, row, x1, pattern[(x1 >> 1) % SPAN_PERIOD], RASTER_COPY);
+    x1++;
+  }
+  if(x1 <= x2 && !(x2 & 1))
+  {
+    plotInRow(surface, row, x2, pattern[(x2 >> 1) % SPAN_PERIOD] >> 4, RASTER_COPY);
+    x2--;
+  }
+  if(x1 < x2)
+    SPAN_fill(row + (x1 >> 1), (x2 - x1 + 1) >> 1, pattern, x1 >> 1);
+}
+
+/* Span in surface coordinates filled with span pattern */
+static void clippedSpan(const RASTER_CONTEXT * ctx, int y, int x1, int x2, const unsigned char * pattern)
+{
+  if(y < ctx->clipTop || y > ctx->clipBottom)
+    return;
+  if(x1 < ctx->clipLeft)
+    x1 = ctx->clipLeft;
+  if(x2 > ctx->clipRight)
+    x2 = ctx->clipRight;
+  if(x1 <= x2)
+    fillSpan(&ctx->surface, y, x1, x2, pattern);
+}
+
+/* Span in surface coordinates filled with current fill pattern, inside is set if it need not be clipped */
+static void patternSpan(const RASTER_CONTEXT * ctx, int y, int x1, int x2, int inside)
+{
+  if(inside)
+    fillSpan(&ctx->surface, y, x1, x2, ctx->fillRows[y & 7]);
+  else
+    clippedSpan(ctx, y, x1, x2, ctx->fillRows[y & 7]);
+}
+
+/**
+ * Clip stage shared by primitives: box [left, right] x [top, bottom] in
+ * surface coordinates that contains everything primitive draws is
+ * CLIP_OUTSIDE (nothing is drawn), CLIP_INSIDE (pixels and spans are
+ * not checked) or CLIP_CROSSES clip rectangle.
+ */
+static int clipBox(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom)
+{
+  if(right < ctx->clipLeft || left > ctx->clipRight || bottom < ctx->clipTop || top > ctx->clipBottom)
+    return CLIP_OUTSIDE;
+  if(left >= ctx->clipLeft && right <= ctx->clipRight && top >= ctx->clipTop && bottom <= ctx->clipBottom)
+    return CLIP_INSIDE;
+  return CLIP_CROSSES;
+}
+
+/**
+ * Rectangle in context coordinates is moved to surface and cut by clip
+ * rectangle, returns 0 if nothing is left
+ */
+static int clipRectangle(const RASTER_CONTEXT * ctx, int * left, int * top, int * right, int * bottom)
+{
+  int t;
+  if(*left > *right)
+  {
+    t = *left; *left = *right; *right = t;
+  }
+  if(*top > *bottom)
+  {
+    t = *top; *top = *bottom; *bottom = t;
+  }
+  *left = *left + ctx->originX < ctx->clipLeft ? ctx->clipLeft : *left + ctx->originX;
+  *top = *top + ctx->originY < ctx->clipTop ? ctx->clipTop : *top + ctx->originY;
+  *right = *right + ctx->originX > ctx->clipRight ? ctx->clipRight : *right + ctx->originX;
+  *bottom = *bottom + ctx->originY > ctx->clipBottom ? ctx->clipBottom : *bottom + ctx->originY;
+  return *left <= *right && *top <= *bottom;
+}
+
+void RASTER_putPixel(const RASTER_CONTEXT * ctx, int x, int y, unsigned color, int op)
+{
+  x += ctx->originX;
+  y += ctx->originY;
+  if(INSIDE(ctx, x, y))
+    plot(&ctx->surface, x, y, color, op);
+}
+
+unsigned RASTER_getPixel(const RASTER_CONTEXT * ctx, int x, int y)
+{
+  x += ctx->originX;
+  y += ctx->originY;
+  if(x < 0 || y < 0 || x >= ctx->surface.width || y >= ctx->surface.height)
+    return 0;
+  return fetch(&ctx->surface, x, y);
+}
+
+/**
+ * Images are rows of 32-bit colors. Rows of 32bpp surfaces are combined
+ * with them directly, 16bpp, 8bpp and 4bpp rows are packed first (4bpp pixels
+ * at odd left and even right edges share bytes with other pixels, they
+ * are plotted)
+ */
+void RASTER_putImage(const RASTER_CONTEXT * ctx, int left, int top, int width, int height, const unsigned * colors, int op)
+{
+  int x1, x2, y1, y2, y, x, i;
+  int spanOp = op == RASTER_NOT ? SPAN_COPY : op;
+  unsigned invert = op == RASTER_NOT ? 0xFFFFFFFF : 0;
+  const unsigned * src;
+  unsigned char * row, * packed;
+  RASTER_SCRATCH local = {NULL, 0};
+
+  left += ctx->originX;
+  top += ctx->originY;
+  x1 = left > ctx->clipLeft ? left : ctx->clipLeft;
+  y1 = top > ctx->clipTop ? top : ctx->clipTop;
+  x2 = left + width - 1 < ctx->clipRight ? left + width - 1 : ctx->clipRight;
+  y2 = top + height - 1 < ctx->clipBottom ? top + height - 1 : ctx->clipBottom;
+  if(x1 > x2 || y1 > y2)
+    return;
+  if(ctx->surface.bpp == 32)
+  {
+    for(y = y1; y <= y2; y++)
+      SPAN_blit(
+        rowOf(&ctx->surface, y) + x1 * 4,
+        (const unsigned char *)(colors + (y - top) * width + (x1 - left)),
+        (x2 - x1 + 1) * 4,
+        spanOp,
+        invert & pixelMask(32)
+        );
+    return;
+  }
+  packed = reserve(ctx, &local, (x2 - x1 + 1) * (ctx->surface.bpp == 16 ? 2 : 1));
+  if(packed == NULL)
+    return;
+  for(y = y1; y <= y2; y++)
+  {
+    row = rowOf(&ctx->surface, y);
+    src = colors + (y - top) * width - left;
+    if(ctx->surface.bpp == 16)
+    {
+      for(x = x1; x <= x2; x++)
+        ((unsigned short *)packed)[x - x1] = (unsigned short)src[x];
+      SPAN_blit(row + x1 * 2, packed, (x2 - x1 + 1) * 2, spanOp, invert);
+      continue;
+    }
+    if(ctx->surface.bpp == 8)
+    {
+      for(x = x1; x <= x2; x++)
+        packed[x - x1] = (unsigned char)src[x];
+      SPAN_blit(row + x1, packed, x2 - x1 + 1, spanOp, invert);
+      continue;
+    }
+    x = x1;
+    if(x & 1)
+    {
+      plotInRow(&ctx->surface, row, x, src[x], op);
+      x++;
+    }
+    if(x2 >= x && !(x2 & 1))
+      plotInRow(&ctx->surface, row, x2, src[x2], op);
+    /* pixels [x, x + 2 * i) are packed */
+    for(i = 0; x + 2 * i + 1 <= x2; i++)
+      packed[i] = (unsigned char)(((src[x + 2 * i] & 0xF) << 4) | (src[x + 2 * i + 1] & 0xF));
+    if(i != 0)
+      SPAN_blit(row + (x >> 1), packed, i, spanOp, invert);
+  }
+  RASTER_freeScratch(&local);
+}
+
+void RASTER_getImage(const RASTER_CONTEXT * ctx, int left, int top, int width, int height, unsigned * colors)
+{
+  int x1, x2, y, x;
+  const unsigned char * row;
+  unsigned * dst;
+
+  left += ctx->originX;
+  top += ctx->originY;
+  x1 = left > 0 ? left : 0;
+  x2 = left + width - 1 < ctx->surface.width - 1 ? left + width - 1 : ctx->surface.width - 1;
+  for(y = top; y != top + height; y++, colors += width)
+  {
+    if(y < 0 || y >= ctx->surface.height || x1 > x2)
+    {
+      memset(colors, 0, width * sizeof(unsigned));
+      continue;
+    }
+    row = rowOf(&ctx->surface, y);
+    dst = colors - left;
+    memset(colors, 0, (x1 - left) * sizeof(unsigned));
+    if(ctx->surface.bpp == 32)
+      memcpy(dst + x1, row + x1 * 4, (x2 - x1 + 1) * sizeof(unsigned));
+    else if(ctx->surface.bpp == 16)
+    {
+      for(x = x1; x <= x2; x++)
+        dst[x] = ((const unsigned short *)row)[x];
+    }
+    else if(ctx->surface.bpp == 8)
+    {
+      for(x = x1; x <= x2; x++)
+        dst[x] = row[x];
+    }
+    else
+    {
+      for(x = x1; x <= x2; x++)
+        dst[x] = (row[x >> 1] >> (x & 1 ? 0 : 4)) & 0xF;
+    }
+    memset(dst + x2 + 1, 0, (left + width - 1 - x2) * sizeof(unsigned));
+  }
+}
+
+/**
+ * Run of opaque pixels of sprite row, 8bpp, 16bpp and 32bpp pixels are stored
+ * as on surface. Pixels of 4bpp runs are packed twice: pairs from the first pixel and pairs from the second one, so
+ * that any part of run is copied by bytes whatever parity of x it is
+ * drawn at.
+ */
+typedef struct
+{
+  int x, length;
+  /* offset of pixels from start of sprite pixels */
+  unsigned offset;
+} SPRITE_RUN;
+
+/* Bytes of pixels of run */
+static unsigned runBytes(int bpp, int length)
+{
+  return bpp == 4 ? length : length * bpp / 8;
+}
+
+/* Pixel i of 4bpp run from pairs packed from the first pixel */
+static unsigned runNibble(const unsigned char * pixels, int i)
+{
+  return (pixels[i >> 1] >> (i & 1 ? 0 : 4)) & 0xF;
+}
+
+static void packRun(int bpp, const unsigned * colors, int length, unsigned char * pixels)
+{
+  int i, pairs = (length + 1) / 2;
+  unsigned short pixel16;
+  if(bpp == 32)
+  {
+    memcpy(pixels, colors, length * 4);
+    return;
+  }
+  if(bpp == 16)
+  {
+    for(i = 0; i != length; i++)
+    {
+      pixel16 = (unsigned short)colors[i];
+      memcpy(pixels + i * 2, &pixel16, 2);
+    }
+    return;
+  }
+  if(bpp == 8)
+  {
+    for(i = 0; i != length; i++)
+      pixels[i] = (unsigned char)colors[i];
+    return;
+  }
+  memset(pixels, 0, length);
+  for(i = 0; i != length; i++)
+  {
+    pixels[i >> 1] |= (unsigned char)((colors[i] & 0xF) << (i & 1 ? 0 : 4));
+    if(i != 0)
+      pixels[pairs + ((i - 1) >> 1)] |= (unsigned char)((colors[i] & 0xF) << (i & 1 ? 4 : 0));
+  }
+}
+
+RASTER_SPRITE * RASTER_createSprite(const unsigned * colors, int width, int height, unsigned key, int bpp)
+{
+  int x, y, start, runCount = 0, run;
+  unsigned bytes = 0, size;
+  const unsigned * row;
+  RASTER_SPRITE * sprite;
+  int * rows;
+  SPRITE_RUN * runs;
+  unsigned char * pixels;
+
+  if(width <= 0 || height <= 0)
+    return NULL;
+  /* runs and pixels are counted first, sprite is one block */
+  for(y = 0, row = colors; y != height; y++, row += width)
+    for(x = 0; x != width; x++)
+      if(row[x] != key && (x == 0 || row[x - 1] == key))
+        runCount++;
+  for(x = 0; x != width * height; x++)
+    if(colors[x] != key)
+      bytes += runBytes(bpp, 1);
+  size = sizeof(RASTER_SPRITE) + (height + 1) * sizeof(int) + runCount * sizeof(SPRITE_RUN) + bytes;
+  size = (size + 3) & ~3u;
+  sprite = malloc(size);
+  if(sprite == NULL)
+    return NULL;
+  sprite->size = size;
+  sprite->width = width;
+  sprite->height = height;
+  sprite->bpp = bpp;
+  sprite->runCount = runCount;
+  rows = (int *)(sprite + 1);
+  runs = (SPRITE_RUN *)(rows + height + 1);
+  pixels = (unsigned char *)(runs + runCount);
+  bytes = 0;
+  run = 0;
+  for(y = 0, row = colors; y != height; y++, row += width)
+  {
+    rows[y] = run;
+    for(x = 0; x != width;)
+    {
+      if(row[x] == key)
+      {
+        x++;
+        continue;
+      }
+      for(start = x; x != width && row[x] != key; x++)
+        ;
+      runs[run].x = start;
+      runs[run].length = x - start;
+      runs[run].offset = bytes;
+      packRun(bpp, row + start, x - start, pixels + bytes);
+      bytes += runBytes(bpp, x - start);
+      run++;
+    }
+  }
+  rows[height] = run;
+  return sprite;
+}
+
+void RASTER_freeSprite(RASTER_SPRITE * sprite)
+{
+  free(sprite);
+}
+
+void RASTER_drawSprite(const RASTER_CONTEXT * ctx, int left, int top, const RASTER_SPRITE * sprite)
+{
+  const int * rows = (const int *)(sprite + 1);
+  const SPRITE_RUN * runs = (const SPRITE_RUN *)(rows + sprite->height + 1), * run, * end;
+  const unsigned char * pixels = (const unsigned char *)(runs + sprite->runCount), * src;
+  unsigned char * row;
+  int x1, x2, y, y2, i;
+
+  if(sprite->bpp != ctx->surface.bpp)
+    return;
+  left += ctx->originX;
+  top += ctx->originY;
+  y = top > ctx->clipTop ? top : ctx->clipTop;
+  y2 = top + sprite->height - 1 < ctx->clipBottom ? top + sprite->height - 1 : ctx->clipBottom;
+  for(; y <= y2; y++)
+  {
+    row = rowOf(&ctx->surface, y);
+    end = runs + rows[y - top + 1];
+    for(run = runs + rows[y - top]; run != end; run++)
+    {
+      x1 = left + run->x;
+      x2 = x1 + run->length - 1;
+      /* i is index of first drawn pixel in run */
+      i = x1 < ctx->clipLeft ? ctx->clipLeft - x1 : 0;
+      x1 += i;
+      if(x2 > ctx->clipRight)
+        x2 = ctx->clipRight;
+      if(x1 > x2)
+        continue;
+      src = pixels + run->offset;
+      if(ctx->surface.bpp == 32)
+      {
+        memcpy(row + x1 * 4, src + i * 4, (x2 - x1 + 1) * 4);
+        continue;
+      }
+      if(ctx->surface.bpp == 16)
+      {
+        memcpy(row + x1 * 2, src + i * 2, (x2 - x1 + 1) * 2);
+        continue;
+      }
+      if(ctx->surface.bpp == 8)
+      {
+        memcpy(row + x1, src + i, x2 - x1 + 1);
+        continue;
+      }
+      if(x1 & 1)
+      {
+        plotInRow(&ctx->surface, row, x1, runNibble(src, i), RASTER_COPY);
+        x1++;
+        i++;
+      }
+      if(x1 <= x2 && !(x2 & 1))
+      {
+        plotInRow(&ctx->surface, row, x2, runNibble(src, i + x2 - x1), RASTER_COPY);
+        x2--;
+      }
+      /* odd i starts pairs packed from the second pixel */
+      if(x1 < x2)
+        memcpy(row + (x1 >> 1), src + (i & 1 ? (run->length + 1) / 2 : 0) + (i >> 1), (x2 - x1 + 1) / 2);
+    }
+  }
+}
+
+void RASTER_clear(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom, unsigned color)
+{
+  int y;
+  unsigned char pattern[2 * SPAN_PERIOD];
+  if(!clipRectangle(ctx, &left, &top, &right, &bottom))
+    return;
+  expandRow(ctx->surface.bpp, 0xFF, color, color, pattern);
+  for(y = top; y <= bottom; y++)
+    fillSpan(&ctx->surface, y, left, right, pattern);
+}
+
+void RASTER_bar(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom)
+{
+  int y;
+  if(!clipRectangle(ctx, &left, &top, &right, &bottom))
+    return;
+  for(y = top; y <= bottom; y++)
+    patternSpan(ctx, y, left, right, 1);
+}
+
+/* Row of pixels [x1, x2], they are inside clip rectangle */
+static void horizontalSpan(const RASTER_SURFACE * surface, int y, int x1, int x2, unsigned color, int op)
+{
+  unsigned char * row = rowOf(surface, y), both;
+  unsigned * p, * end;
+  unsigned short * p16;
+  int count;
+  if(surface->bpp == 32)
+  {
+    end = (unsigned *)row + x2;
+    if(op == RASTER_XOR)
+      for(p = (unsigned *)row + x1; p <= end; p++)
+        *p ^= color;
+    else
+      for(p = (unsigned *)row + x1; p <= end; p++)
+        *p = color;
+    return;
+  }
+  if(surface->bpp == 16)
+  {
+    p16 = (unsigned short *)row + x1;
+    count = x2 - x1 + 1;
+    if(op == RASTER_XOR)
+      while(count-- != 0)
+        *p16++ ^= (unsigned short)color;
+    else
+      while(count-- != 0)
+        *p16++ = (unsigned short)color;
+    return;
+  }
+  if(surface->bpp == 8)
+  {
+    row += x1;
+    count = x2 - x1 + 1;
+    if(op == RASTER_XOR)
+      while(count-- != 0)
+        *row++ ^= (unsigned char)color;
+    else
+      memset(row, (unsigned char)color, count);
+    return;
+  }
+  /* odd first and even last pixels share bytes with pixels that are not drawn */
+  if(x1 & 1)
+    plotInRow(surface, row, x1++, color, op);
+  if(x1 <= x2 && !(x2 & 1))
+    plotInRow(surface, row, x2--, color, op);
+  if(x1 > x2)
+    return;
+  both = (unsigned char)((color & 0xF) * 0x11);
+  row += x1 >> 1;
+  count = (x2 - x1 + 1) >> 1;
+  if(op == RASTER_XOR)
+    while(count-- != 0)
+      *row++ ^= both;
+  else
+    memset(row, both, count);
+}
+
+/* Column of pixels [y1, y2], they are inside clip rectangle */
+static void verticalSpan(const RASTER_SURFACE * surface, int x, int y1, int y2, unsigned color, int op)
+{
+  unsigned char * row = rowOf(surface, y1);
+  /* rows are bottom-up, so next row is lower in memory */
+  for(; y1 <= y2; y1++, row -= surface->stride)
+    plotInRow(surface, row, x, color, op);
+}
+
+/**
+ * Narrows steps [first, last] of line to ones where coordinate c0 + s * f(k)
+ * is in [lo, hi]. Coordinate moves by f(k) = floor((2 * d * k + n) / (2 * n))
+ * after k steps, where n is length of major axis and d is length of the
+ * axis (f(k) = k for major one). Returns 0 if no step is left.
+ */
+static int clipSteps(int c0, int s, int lo, int hi, int d, int n, int * first, int * last)
+{
+  RASTER_INT64 a = s > 0 ? (RASTER_INT64)lo - c0 : (RASTER_INT64)c0 - hi;
+  RASTER_INT64 b = s > 0 ? (RASTER_INT64)hi - c0 : (RASTER_INT64)c0 - lo, k;
+  /* f(k) must be in [a, b] */
+  if(b < 0 || (d == 0 && a > 0))
+    return 0;
+  if(d != 0)
+  {
+    if(a > 0)
+    {
+      k = (2 * (RASTER_INT64)n * a - n + 2 * (RASTER_INT64)d - 1) / (2 * (RASTER_INT64)d);
+      if(k > *first)
+        *first = k > n ? n + 1 : (int)k;
+    }
+    k = (2 * (RASTER_INT64)n * b + n - 1) / (2 * (RASTER_INT64)d);
+    if(k < *last)
+      *last = (int)k;
+  }
+  return *first <= *last;
+}
+
+/**
+ * Coordinates of thin lines are kept within this distance of page origin,
+ * so lengths of axes and error terms of thinLine fit into int.
+ */
+#define LINE_LIMIT (1 << 27)
+
+/* Narrows [t0, t1] to parameters t where p * t <= q. Returns 0 if none is left */
+static int limitParameter(double p, double q, double * t0, double * t1)
+{
+  double r;
+  if(p == 0)
+    return q >= 0;
+  r = q / p;
+  if(p < 0)
+  {
+    if(r > *t1)
+      return 0;
+    if(r > *t0)
+      *t0 = r;
+  }
+  else
+  {
+    if(r < *t0)
+      return 0;
+    if(r < *t1)
+      *t1 = r;
+  }
+  return 1;
+}
+
+/**
+ * Moves ends that are farther than LINE_LIMIT along the line into the
+ * limit square. Page is far inside it, so only rounding of moved ends
+ * may shift pixels of such lines by one. Returns 0 if line misses square.
+ */
+static int limitLine(int * x1, int * y1, int * x2, int * y2)
+{
+  double px = *x1, py = *y1, dx = (double)*x2 - *x1, dy = (double)*y2 - *y1;
+  double t0 = 0, t1 = 1;
+  if(!limitParameter(-dx, px + LINE_LIMIT, &t0, &t1) || !limitParameter(dx, LINE_LIMIT - px, &t0, &t1) ||
+     !limitParameter(-dy, py + LINE_LIMIT, &t0, &t1) || !limitParameter(dy, LINE_LIMIT - py, &t0, &t1))
+    return 0;
+  *x1 = (int)floor(px + t0 * dx + .5);
+  *y1 = (int)floor(py + t0 * dy + .5);
+  *x2 = (int)floor(px + t1 * dx + .5);
+  *y2 = (int)floor(py + t1 * dy + .5);
+  return 1;
+}
+
+#define OUTSIDE_LIMIT(C) ((C) > LINE_LIMIT || (C) < -LINE_LIMIT)
+
+/**
+ * Bresenham line of one pixel width in surface coordinates. Line is
+ * clipped by parameter before it is drawn (Liang-Barsky on steps of
+ * major axis): clipSteps finds steps inside clip rectangle exactly and
+ * error term is computed at the first of them, so pixels are not
+ * checked and line pattern keeps its phase.
+ */
+static void thinLine(const RASTER_CONTEXT * ctx, int x1, int y1, int x2, int y2)
+{
+  int dx, dy, sx, sy, n, first = 0, last, i, t, e2, x, y, err;
+  unsigned pattern = ctx->linePattern & 0xFFFF;
+  unsigned char * row;
+  int rowStep;
+
+  /* whole line is outside */
+  if((x1 < ctx->clipLeft && x2 < ctx->clipLeft) || (x1 > ctx->clipRight && x2 > ctx->clipRight) ||
+     (y1 < ctx->clipTop && y2 < ctx->clipTop) || (y1 > ctx->clipBottom && y2 > ctx->clipBottom))
+    return;
+  if(pattern == RASTER_SOLID_LINE && (y1 == y2 || x1 == x2))
+  {
+    if(x1 > x2)
+    {
+      t = x1; x1 = x2; x2 = t;
+    }
+    if(y1 > y2)
+    {
+      t = y1; y1 = y2; y2 = t;
+    }
+    if(x1 < ctx->clipLeft)
+      x1 = ctx->clipLeft;
+    if(x2 > ctx->clipRight)
+      x2 = ctx->clipRight;
+    if(y1 < ctx->clipTop)
+      y1 = ctx->clipTop;
+    if(y2 > ctx->clipBottom)
+      y2 = ctx->clipBottom;
+    if(y1 == y2)
+      horizontalSpan(&ctx->surface, y1, x1, x2, ctx->color, ctx->writeMode);
+    else
+      verticalSpan(&ctx->surface, x1, y1, y2, ctx->color, ctx->writeMode);
+    return;
+  }
+  if((OUTSIDE_LIMIT(x1) || OUTSIDE_LIMIT(y1) || OUTSIDE_LIMIT(x2) || OUTSIDE_LIMIT(y2)) &&
+     !limitLine(&x1, &y1, &x2, &y2))
+    return;
+  dx = abs(x2 - x1);
+  dy = -abs(y2 - y1);
+  sx = x1 < x2 ? 1 : -1;
+  sy = y1 < y2 ? 1 : -1;
+  n = dx > -dy ? dx : -dy;
+  rowStep = -sy * ctx->surface.stride;
+  last = n;
+  if(!clipSteps(x1, sx, ctx->clipLeft, ctx->clipRight, dx, n, &first, &last) ||
+     !clipSteps(y1, sy, ctx->clipTop, ctx->clipBottom, -dy, n, &first, &last))
+    return;
+  /* position and error term after first steps */
+  x = n == 0 ? 0 : (int)((2 * (RASTER_INT64)dx * first + n) / (2 * (RASTER_INT64)n));
+  y = n == 0 ? 0 : (int)((2 * (RASTER_INT64)-dy * first + n) / (2 * (RASTER_INT64)n));
+  err = (int)(dx + dy + (RASTER_INT64)dy * x + (RASTER_INT64)dx * y);
+  x = x1 + sx * x;
+  y = y1 + sy * y;
+  row = rowOf(&ctx->surface, y);
+  for(i = first; ; i++)
+  {
+    if((pattern >> (i & 15)) & 1)
+      plotInRow(&ctx->surface, row, x, ctx->color, ctx->writeMode);
+    if(i == last)
+      break;
+    e2 = 2 * err;
+    if(e2 >= dy)
+    {
+      err += dy;
+      x += sx;
+    }
+    if(e2 <= dx)
+    {
+      err += dx;
+      row += rowStep;
+    }
+  }
+}
+
+void RASTER_line(const RASTER_CONTEXT * ctx, int x1, int y1, int x2, int y2)
+{
+  x1 += ctx->originX;
+  y1 += ctx->originY;
+  x2 += ctx->originX;
+  y2 += ctx->originY;
+  thinLine(ctx, x1, y1, x2, y2);
+  if(ctx->lineWidth <= 1)
+    return;
+  /* as in BGI, thick line is three lines shifted across major direction */
+  if(fabs((double)x2 - x1) >= fabs((double)y2 - y1))
+  {
+    thinLine(ctx, x1, y1 - 1, x2, y2 - 1);
+    thinLine(ctx, x1, y1 + 1, x2, y2 + 1);
+  }
+  else
+  {
+    thinLine(ctx, x1 - 1, y1, x2 - 1, y2);
+    thinLine(ctx, x1 + 1, y1, x2 + 1, y2);
+  }
+}
+
+/**
+ * Thick rectangle in surface coordinates, top <= bottom. Sides are bands
+ * three pixels across and every pixel is drawn once (in XOR mode pixels
+ * drawn twice would disappear): top and bottom bands span whole width
+ * with corners, left and right ones only rows between them.
+ */
+static void thickRectangle(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom)
+{
+  int i;
+  if(left > right)
+  {
+    i = left; left = right; right = i;
+  }
+  for(i = top - 1; i <= bottom + 1; i++)
+  {
+    if(i == top + 2 && bottom - 1 > i)
+      i = bottom - 1;
+    thinLine(ctx, left - 1, i, right + 1, i);
+  }
+  if(bottom - top < 4)
+    return;
+  for(i = left - 1; i <= right + 1; i++)
+  {
+    if(i == left + 2 && right - 1 > i)
+      i = right - 1;
+    thinLine(ctx, i, top + 2, i, bottom - 2);
+  }
+}
+
+void RASTER_rectangle(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom)
+{
+  int t;
+  if(top > bottom)
+  {
+    t = top; top = bottom; bottom = t;
+  }
+  if(ctx->lineWidth > 1)
+  {
+    thickRectangle(ctx, left + ctx->originX, top + ctx->originY, right + ctx->originX, bottom + ctx->originY);
+    return;
+  }
+  RASTER_line(ctx, left, top, right, top);
+  if(top == bottom)
+    return;
+  RASTER_line(ctx, left, bottom, right, bottom);
+  /* corners of thin rectangle are already drawn, in XOR mode they must not be drawn twice */
+  if(bottom - top > 1)
+  {
+    RASTER_line(ctx, left, top + 1, left, bottom - 1);
+    if(left != right)
+      RASTER_line(ctx, right, top + 1, right, bottom - 1);
+  }
+}
+
+static int floorDiv(int a, int b)
+{
+  return a >= 0 ? a / b : -((b - 1 - a) / b);
+}
+
+/* Quadrant point of ellipse, offsets from center (y grows up) */
+typedef struct
+{
+  int x, y;
+} ARC_POINT;
+
+/* Returns round(radius * sin(angle)), angle is in degrees */
+static int scaleSin(int radius, int angle)
+{
+  int negative = radius < 0;
+  RASTER_INT64 value;
+  angle %= 360;
+  if(angle < 0)
+    angle += 360;
+  if(angle >= 180)
+  {
+    angle -= 180;
+    negative = !negative;
+  }
+  if(angle > 90)
+    angle = 180 - angle;
+  value = ((RASTER_INT64)abs(radius) * sinTable[angle] + 0x8000) >> 16;
+  return negative ? -(int)value : (int)value;
+}
+
+void RASTER_arcPoint(int x, int y, int angle, int xradius, int yradius, int * px, int * py)
+{
+  *px = x + scaleSin(xradius, angle + 90);
+  *py = y - scaleSin(yradius, angle);
+}
+
+/**
+ * Returns sign of difference between parametric angle of quadrant point
+ * and angle (degrees in [0, 90]), radii are not negative.
+ */
+static int compareAngle(const ARC_POINT * p, int angle, int xradius, int yradius)
+{
+  RASTER_INT64 a, b;
+  if(yradius == 0)
+  {
+    /* flat ellipse, angle grows while x goes to center */
+    a = (RASTER_INT64)xradius * sinTable[90 - angle];
+    b = (RASTER_INT64)p->x << 16;
+  }
+  else if(xradius == 0)
+  {
+    a = (RASTER_INT64)p->y << 16;
+    b = (RASTER_INT64)yradius * sinTable[angle];
+  }
+  else
+  {
+    /* sign of cross product of point scaled to circle and direction of angle */
+    a = (RASTER_INT64)p->y * xradius * sinTable[90 - angle];
+    b = (RASTER_INT64)p->x * yradius * sinTable[angle];
+  }
+  return a < b ? -1 : a > b;
+}
+
+/* Returns index of first point (of count) whose angle compares with angle at least as limit */
+static int findAngle(const ARC_POINT * points, int count, int angle, int xradius, int yradius, int limit)
+{
+  int low = 0, high = count, middle;
+  while(low < high)
+  {
+    middle = (low + high) / 2;
+    if(compareAngle(points + middle, angle, xradius, yradius) < limit)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+/**
+ * Returns points of first quadrant of ellipse from (xradius, 0) to
+ * (0, yradius), they are ordered by angle. Integer midpoint algorithm:
+ * first part steps y and chooses x while slope is below 1, second one
+ * steps x from the top. Radii are not negative.
+ */
+static ARC_POINT * quadrant(const RASTER_CONTEXT * ctx, RASTER_SCRATCH * local, int xradius, int yradius, size_t extra, int * count)
+{
+  int capacity = xradius + yradius + 2, n = 0, top, x, y;
+  RASTER_INT64 a2 = (RASTER_INT64)xradius * xradius, b2 = (RASTER_INT64)yradius * yradius;
+  RASTER_INT64 error, xchange, ychange, stopX, stopY;
+  ARC_POINT * points = reserve(ctx, local, capacity * sizeof(ARC_POINT) + extra);
+  if(points == NULL)
+    return NULL;
+  if(xradius == 0 || yradius == 0)
+  {
+    /* flat ellipse is segment */
+    for(x = xradius; x >= 0; x--, n++)
+      points[n].x = x, points[n].y = 0;
+    for(y = 1; y <= yradius; y++, n++)
+      points[n].x = 0, points[n].y = y;
+    *count = n;
+    return points;
+  }
+  x = xradius;
+  y = 0;
+  xchange = b2 * (1 - 2 * xradius);
+  ychange = a2;
+  error = 0;
+  stopX = 2 * b2 * xradius;
+  stopY = 0;
+  while(stopX >= stopY)
+  {
+    points[n].x = x;
+    points[n++].y = y;
+    y++;
+    stopY += 2 * a2;
+    error += ychange;
+    ychange += 2 * a2;
+    if(2 * error + xchange > 0)
+    {
+      x--;
+      stopX -= 2 * b2;
+      error += xchange;
+      xchange += 2 * b2;
+    }
+  }
+  /* second part goes from the end of array back to first part */
+  top = capacity;
+  x = 0;
+  y = yradius;
+  xchange = b2;
+  ychange = a2 * (1 - 2 * yradius);
+  error = 0;
+  stopX = 0;
+  stopY = 2 * a2 * yradius;
+  while(stopX <= stopY)
+  {
+    points[--top].x = x;
+    points[top].y = y;
+    x++;
+    stopX += 2 * b2;
+    error += xchange;
+    xchange += 2 * b2;
+    if(2 * error + ychange > 0)
+    {
+      y--;
+      stopY -= 2 * a2;
+      error += ychange;
+      ychange += 2 * a2;
+    }
+  }
+  /* parts may meet at the same point */
+  if(points[top].x == points[n - 1].x && points[top].y == points[n - 1].y)
+    top++;
+  memmove(points + n, points + top, (capacity - top) * sizeof(ARC_POINT));
+  *count = n + capacity - top;
+  return points;
+}
+
+/* Point of quadrant where outline is steeper than 45 degrees (normal to it is closer to x axis) */
+static int steepPoint(const ARC_POINT * p, int xradius, int yradius)
+{
+  /* flat ellipse is segment, it is steep if it is vertical */
+  if(xradius == 0 || yradius == 0)
+    return xradius == 0;
+  return (RASTER_INT64)p->x * yradius * yradius >= (RASTER_INT64)p->y * xradius * xradius;
+}
+
+/* Directions thick outline is widened in at quadrant point, see plotOutline */
+#define WIDEN_X 1
+#define WIDEN_Y 2
+
+/**
+ * As in BGI, thick outline is three pixels across it like thick line is:
+ * side by side where outline is steep, one above another elsewhere. Where
+ * outline turns across 45 degrees pixels are added both ways, so there is
+ * no notch. Thin outline is not widened.
+ */
+static int widening(const RASTER_CONTEXT * ctx, const ARC_POINT * points, int count, int i, int xradius, int yradius)
+{
+  int steep;
+  if(ctx->lineWidth <= 1)
+    return 0;
+  steep = steepPoint(points + i, xradius, yradius);
+  if((i != 0 && steepPoint(points + i - 1, xradius, yradius) != steep) ||
+     (i + 1 != count && steepPoint(points + i + 1, xradius, yradius) != steep))
+    return WIDEN_X | WIDEN_Y;
+  return steep ? WIDEN_X : WIDEN_Y;
+}
+
+static void plotOutlinePixel(const RASTER_CONTEXT * ctx, int x, int y, int inside)
+{
+  if(inside || INSIDE(ctx, x, y))
+    plot(&ctx->surface, x, y, ctx->color, RASTER_COPY);
+}
+
+/* Pixel of outline in surface coordinates widened as widening tells, inside is set if it need not be clipped */
+static void plotOutline(const RASTER_CONTEXT * ctx, int x, int y, int widen, int inside)
+{
+  plotOutlinePixel(ctx, x, y, inside);
+  if(widen & WIDEN_X)
+  {
+    plotOutlinePixel(ctx, x - 1, y, inside);
+    plotOutlinePixel(ctx, x + 1, y, inside);
+  }
+  if(widen & WIDEN_Y)
+  {
+    plotOutlinePixel(ctx, x, y - 1, inside);
+    plotOutlinePixel(ctx, x, y + 1, inside);
+  }
+}
+
+/* Draws points of quadrant in all four quadrants around (x, y) in surface coordinates */
+static void plotQuadrants(const RASTER_CONTEXT * ctx, int x, int y, const ARC_POINT * points, int count, int xradius, int yradius, int inside)
+{
+  int i, px, py, widen;
+  for(i = 0; i != count; i++)
+  {
+    px = points[i].x;
+    py = points[i].y;
+    widen = widening(ctx, points, count, i, xradius, yradius);
+    /* points on axes are not drawn twice */
+    plotOutline(ctx, x + px, y - py, widen, inside);
+    if(px != 0)
+      plotOutline(ctx, x - px, y - py, widen, inside);
+    if(py != 0)
+    {
+      plotOutline(ctx, x + px, y + py, widen, inside);
+      if(px != 0)
+        plotOutline(ctx, x - px, y + py, widen, inside);
+    }
+  }
+}
+
+/* Box of ellipse around (x, y) in surface coordinates against clip rectangle, thick outline is a pixel wider */
+static int clipEllipse(const RASTER_CONTEXT * ctx, int x, int y, int xradius, int yradius)
+{
+  int margin = ctx->lineWidth > 1;
+  return clipBox(ctx, x - xradius - margin, y - yradius - margin, x + xradius + margin, y + yradius + margin);
+}
+
+/**
+ * Arc is drawn by quadrants: angles of every quadrant it covers are
+ * turned into range of points of first quadrant (by binary search, as
+ * points are ordered by angle), that are mirrored into that quadrant.
+ */
+void RASTER_ellipse(const RASTER_CONTEXT * ctx, int x, int y, int stangle, int endangle, int xradius, int yradius)
+{
+  RASTER_SCRATCH local = {NULL, 0};
+  ARC_POINT * points;
+  int count, inside, k, from, to, first, last, i, px, py, widen;
+
+  xradius = abs(xradius);
+  yradius = abs(yradius);
+  x += ctx->originX;
+  y += ctx->originY;
+  inside = clipEllipse(ctx, x, y, xradius, yradius);
+  if(inside == CLIP_OUTSIDE)
+    return;
+  inside = inside == CLIP_INSIDE;
+  points = quadrant(ctx, &local, xradius, yradius, 0, &count);
+  if(points == NULL)
+    return;
+  /* start is moved to [0, 360), end is after it */
+  i = stangle % 360 + (stangle % 360 < 0 ? 360 : 0);
+  endangle += i - stangle;
+  stangle = i;
+  while(endangle < stangle)
+    endangle += 360;
+  if(endangle - stangle >= 360)
+  {
+    plotQuadrants(ctx, x, y, points, count, xradius, yradius, inside);
+    RASTER_freeScratch(&local);
+    return;
+  }
+  for(k = stangle / 90; k <= endangle / 90; k++)
+  {
+    from = (stangle > 90 * k ? stangle : 90 * k) - 90 * k;
+    to = (endangle < 90 * k + 90 ? endangle : 90 * k + 90) - 90 * k;
+    /* angle decreases along points of odd quadrants */
+    if(k & 1)
+    {
+      i = from;
+      from = 90 - to;
+      to = 90 - i;
+    }
+    first = findAngle(points, count, from, xradius, yradius, 0);
+    last = findAngle(points, count, to, xradius, yradius, 1);
+    for(i = first; i < last; i++)
+    {
+      px = points[i].x;
+      py = points[i].y;
+      widen = widening(ctx, points, count, i, xradius, yradius);
+      switch(k & 3)
+      {
+      case 0:
+        plotOutline(ctx, x + px, y - py, widen, inside);
+        break;
+      case 1:
+        plotOutline(ctx, x - px, y - py, widen, inside);
+        break;
+      case 2:
+        plotOutline(ctx, x - px, y + py, widen, inside);
+        break;
+      default:
+        plotOutline(ctx, x + px, y + py, widen, inside);
+      }
+    }
+  }
+  RASTER_freeScratch(&local);
+}
+
+/* Half widths of rows of ellipse are the largest x of its points on them */
+static void rowWidths(const ARC_POINT * points, int count, int yradius, int * widths)
+{
+  int i;
+  for(i = 0; i <= yradius; i++)
+    widths[i] = 0;
+  for(i = 0; i != count; i++)
+    if(points[i].x > widths[points[i].y])
+      widths[points[i].y] = points[i].x;
+}
+
+void RASTER_fillEllipse(const RASTER_CONTEXT * ctx, int x, int y, int xradius, int yradius)
+{
+  RASTER_SCRATCH local = {NULL, 0};
+  ARC_POINT * points;
+  int * widths, count, dy, inside;
+
+  xradius = abs(xradius);
+  yradius = abs(yradius);
+  x += ctx->originX;
+  y += ctx->originY;
+  inside = clipEllipse(ctx, x, y, xradius, yradius);
+  if(inside == CLIP_OUTSIDE)
+    return;
+  inside = inside == CLIP_INSIDE;
+  points = quadrant(ctx, &local, xradius, yradius, (yradius + 1) * sizeof(int), &count);
+  if(points == NULL)
+    return;
+  widths = (int *)(points + xradius + yradius + 2);
+  rowWidths(points, count, yradius, widths);
+  for(dy = 0; dy <= yradius; dy++)
+  {
+    patternSpan(ctx, y - dy, x - widths[dy], x + widths[dy], inside);
+    if(dy != 0)
+      patternSpan(ctx, y + dy, x - widths[dy], x + widths[dy], inside);
+  }
+  plotQuadrants(ctx, x, y, points, count, xradius, yradius, inside);
+  RASTER_freeScratch(&local);
+}
+
+#define NO_LIMIT 0x7FFFFFFF
+
+/**
+ * Range [lo, hi] of x of row y where (x, y) is to the left of direction
+ * (ax, ay) or on it (cross product is not negative), y grows up
+ */
+static void halfPlane(int ax, int ay, int y, int * lo, int * hi)
+{
+  *lo = -NO_LIMIT;
+  *hi = NO_LIMIT;
+  if(ay > 0)
+    *hi = floorDiv(ax * y, ay);
+  else if(ay < 0)
+    *lo = -floorDiv(ax * y, -ay);
+  else if(ax * y < 0)
+  {
+    *lo = NO_LIMIT;
+    *hi = -NO_LIMIT;
+  }
+}
+
+/**
+ * Sector is filled by rows of ellipse cut by radii to ends of arc:
+ * sector up to 180 degrees is intersection of half-planes to the left
+ * of start radius and to the right of end one, bigger one is their union.
+ */
+void RASTER_sector(const RASTER_CONTEXT * ctx, int x, int y, int stangle, int endangle, int xradius, int yradius)
+{
+  RASTER_CONTEXT outline = *ctx;
+  RASTER_SCRATCH local = {NULL, 0};
+  ARC_POINT * points;
+  int * widths, count, cx, cy, dy, w, sx, sy, ex, ey, lo1, hi1, lo2, hi2, inside;
+
+  xradius = abs(xradius);
+  yradius = abs(yradius);
+  cx = x + ctx->originX;
+  cy = y + ctx->originY;
+  /* radii end on ellipse, so outline is inside its box too */
+  inside = clipEllipse(ctx, cx, cy, xradius, yradius);
+  if(inside == CLIP_OUTSIDE)
+    return;
+  inside = inside == CLIP_INSIDE;
+  while(endangle < stangle)
+    endangle += 360;
+  points = quadrant(ctx, &local, xradius, yradius, (yradius + 1) * sizeof(int), &count);
+  if(points == NULL)
+    return;
+  widths = (int *)(points + xradius + yradius + 2);
+  rowWidths(points, count, yradius, widths);
+  RASTER_arcPoint(0, 0, stangle, xradius, yradius, &sx, &sy);
+  RASTER_arcPoint(0, 0, endangle, xradius, yradius, &ex, &ey);
+  for(dy = -yradius; dy <= yradius; dy++)
+  {
+    w = widths[abs(dy)];
+    if(endangle - stangle >= 360)
+    {
+      patternSpan(ctx, cy - dy, cx - w, cx + w, inside);
+      continue;
+    }
+    /* arc points are in screen coordinates, y goes down there */
+    halfPlane(sx, -sy, dy, &lo1, &hi1);
+    halfPlane(-ex, ey, dy, &lo2, &hi2);
+    lo1 = lo1 < -w ? -w : lo1;
+    hi1 = hi1 > w ? w : hi1;
+    lo2 = lo2 < -w ? -w : lo2;
+    hi2 = hi2 > w ? w : hi2;
+    if(endangle - stangle <= 180)
+    {
+      if(lo2 > lo1)
+        lo1 = lo2;
+      if(hi2 < hi1)
+        hi1 = hi2;
+      if(lo1 <= hi1)
+        patternSpan(ctx, cy - dy, cx + lo1, cx + hi1, inside);
+    }
+    else if(lo1 <= hi1 && lo2 <= hi2 && lo2 <= hi1 + 1 && lo1 <= hi2 + 1)
+    {
+      /* ranges overlap or touch */
+      patternSpan(ctx, cy - dy, cx + (lo1 < lo2 ? lo1 : lo2), cx + (hi1 > hi2 ? hi1 : hi2), inside);
+    }
+    else
+    {
+      if(lo1 <= hi1)
+        patternSpan(ctx, cy - dy, cx + lo1, cx + hi1, inside);
+      if(lo2 <= hi2)
+        patternSpan(ctx, cy - dy, cx + lo2, cx + hi2, inside);
+    }
+  }
+  RASTER_freeScratch(&local);
+
+  outline.writeMode = RASTER_COPY;
+  outline.linePattern = RASTER_SOLID_LINE;
+  RASTER_ellipse(&outline, x, y, stangle, endangle, xradius, yradius);
+  RASTER_line(&outline, x, y, x + sx, y + sy);
+  RASTER_line(&outline, x, y, x + ex, y + ey);
+}
+
+/**
+ * Polygon edge, it crosses rows [top, bottom). x of row is exact
+ * intersection rounded, it is x + remainder / denominator where
+ * remainder is in [0, denominator), so edge is stepped by integers.
+ */
+typedef struct
+{
+  int top, bottom;
+  /* twice the length of edge along axis does not fit into int */
+  RASTER_INT64 x, remainder, denominator;
+  RASTER_INT64 stepX, stepRemainder;
+  /* 1 if edge goes down, -1 if up */
+  int winding;
+} EDGE;
+
+static RASTER_INT64 floorDiv64(RASTER_INT64 a, RASTER_INT64 b)
+{
+  return a >= 0 ? a / b : -((b - 1 - a) / b);
+}
+
+/* Edge is not horizontal */
+static void initEdge(EDGE * edge, int x1, int y1, int x2, int y2)
+{
+  int t;
+  RASTER_INT64 dx2;
+  edge->winding = 1;
+  if(y1 > y2)
+  {
+    edge->winding = -1;
+    t = x1; x1 = x2; x2 = t;
+    t = y1; y1 = y2; y2 = t;
+  }
+  edge->top = y1;
+  edge->bottom = y2;
+  /* x(y) = x1 + floor(((y - y1) * 2 * dx + dy) / (2 * dy)) */
+  edge->x = x1;
+  edge->denominator = 2 * ((RASTER_INT64)y2 - y1);
+  edge->remainder = (RASTER_INT64)y2 - y1;
+  dx2 = 2 * ((RASTER_INT64)x2 - x1);
+  edge->stepX = floorDiv64(dx2, edge->denominator);
+  edge->stepRemainder = dx2 - edge->stepX * edge->denominator;
+}
+
+/**
+ * Moves edge from top to row y. rows * stepRemainder may not fit into 64
+ * bits, so whole steps are estimated in double and remainder is computed
+ * modulo 2^64 (it is exact, because true one is small), then corrected.
+ */
+static void skipRows(EDGE * edge, int y)
+{
+  RASTER_INT64 rows = (RASTER_INT64)y - edge->top, steps, remainder;
+  steps = (RASTER_INT64)floor(((double)rows * edge->stepRemainder + edge->remainder) / edge->denominator);
+  remainder = (RASTER_INT64)((RASTER_UINT64)rows * (RASTER_UINT64)edge->stepRemainder +
+    (RASTER_UINT64)edge->remainder - (RASTER_UINT64)steps * (RASTER_UINT64)edge->denominator);
+  for(; remainder < 0; steps--)
+    remainder += edge->denominator;
+  for(; remainder >= edge->denominator; steps++)
+    remainder -= edge->denominator;
+  edge->x += rows * edge->stepX + steps;
+  edge->remainder = remainder;
+}
+
+static void stepEdge(EDGE * edge)
+{
+  edge->x += edge->stepX;
+  edge->remainder += edge->stepRemainder;
+  if(edge->remainder >= edge->denominator)
+  {
+    edge->x++;
+    edge->remainder -= edge->denominator;
+  }
+}
+
+/* Differences of coordinates may not fit into int, so they are compared */
+static int compareEdges(const void * a, const void * b)
+{
+  int ta = ((const EDGE *)a)->top, tb = ((const EDGE *)b)->top;
+  return ta < tb ? -1 : ta > tb;
+}
+
+static int compareX(const void * a, const void * b)
+{
+  RASTER_INT64 xa = (*(const EDGE * const *)a)->x, xb = (*(const EDGE * const *)b)->x;
+  return xa < xb ? -1 : xa > xb;
+}
+
+/**
+ * Sorts active edges by x. Order changes little from row to row, so
+ * insertion sort is used until it is clear that edges are shuffled
+ * (many edges of self-intersecting polygons cross each other)
+ */
+static void sortActive(EDGE ** list, int count)
+{
+  int i, j, moves = 0;
+  EDGE * e;
+  for(i = 1; i < count; i++)
+  {
+    e = list[i];
+    for(j = i; j > 0 && list[j - 1]->x > e->x; j--)
+      list[j] = list[j - 1];
+    list[j] = e;
+    moves += i - j;
+    if(moves > 8 * count)
+    {
+      qsort(list, count, sizeof(EDGE *), compareX);
+      return;
+    }
+  }
+}
+
+/**
+ * Fills spans between active edges of row y (in context coordinates) by
+ * fill rule, inside is set if polygon need not be clipped
+ */
+static void fillRow(const RASTER_CONTEXT * ctx, int y, EDGE ** active, int count, int inside)
+{
+  int i, winding = 0, start = 0;
+  y += ctx->originY;
+  if(ctx->fillRule == RASTER_NONZERO)
+  {
+    for(i = 0; i != count; i++)
+    {
+      if(winding == 0)
+        start = (int)active[i]->x;
+      winding += active[i]->winding;
+      if(winding == 0)
+        patternSpan(ctx, y, start + ctx->originX, (int)active[i]->x + ctx->originX, inside);
+    }
+    return;
+  }
+  for(i = 0; i + 1 < count; i += 2)
+    patternSpan(ctx, y, (int)active[i]->x + ctx->originX, (int)active[i + 1]->x + ctx->originX, inside);
+}
+
+/**
+ * Scanline filler: edges are sorted by top row, edges that cross row
+ * are active, they are kept sorted by x
+ */
+void RASTER_fillPoly(const RASTER_CONTEXT * ctx, int numpoints, const int * points)
+{
+  int i, j, y, count = 0, active = 0, next = 0, miny, maxy, left, top, right, bottom, inside;
+  const int * a, * b;
+  EDGE * edges, ** list;
+  RASTER_SCRATCH local = {NULL, 0};
+
+  if(numpoints < 3)
+    return;
+  /* x of edges on rows is between x of their ends */
+  left = right = points[0];
+  top = bottom = points[1];
+  for(i = 1; i != numpoints; i++)
+  {
+    left = points[i * 2] < left ? points[i * 2] : left;
+    right = points[i * 2] > right ? points[i * 2] : right;
+    top = points[i * 2 + 1] < top ? points[i * 2 + 1] : top;
+    bottom = points[i * 2 + 1] > bottom ? points[i * 2 + 1] : bottom;
+  }
+  inside = clipBox(ctx, left + ctx->originX, top + ctx->originY, right + ctx->originX, bottom + ctx->originY);
+  if(inside == CLIP_OUTSIDE)
+    return;
+  inside = inside == CLIP_INSIDE;
+  miny = ctx->clipTop - ctx->originY;
+  maxy = ctx->clipBottom - ctx->originY;
+  edges = reserve(ctx, &local, numpoints * (sizeof(EDGE) + sizeof(EDGE *)));
+  if(edges == NULL)
+    return;
+  list = (EDGE **)(edges + numpoints);
+  for(i = 0, j = numpoints - 1; i != numpoints; j = i++)
+  {
+    a = points + j * 2;
+    b = points + i * 2;
+    /* horizontal edges and edges above or below clip rectangle are not needed */
+    if(a[1] == b[1] || (a[1] <= miny && b[1] <= miny) || (a[1] > maxy && b[1] > maxy))
+      continue;
+    initEdge(edges + count++, a[0], a[1], b[0], b[1]);
+  }
+  qsort(edges, count, sizeof(EDGE), compareEdges);
+  y = count != 0 && edges[0].top > miny ? edges[0].top : miny;
+  for(; y <= maxy && (next != count || active != 0); y++)
+  {
+    for(; next != count && edges[next].top <= y; next++)
+    {
+      if(edges[next].top < y)
+        skipRows(edges + next, y);
+      list[active++] = edges + next;
+    }
+    sortActive(list, active);
+    fillRow(ctx, y, list, active, inside);
+    /* edges that end on this row are removed, others move to next one */
+    for(i = j = 0; i != active; i++)
+    {
+      if(list[i]->bottom == y + 1)
+        continue;
+      stepEdge(list[i]);
+      list[j++] = list[i];
+    }
+    active = j;
+  }
+  RASTER_freeScratch(&local);
+}
+
+/* Pixel of span that flood fill has not filled yet */
+typedef struct
+{
+  int x, y;
+} FLOOD_SEED;
+
+/**
+ * Scratch of flood fill is bitmap of filled pixels of clip rectangle
+ * (filled pixels may have any color, so color does not tell them)
+ * followed by stack of seeds, stack grows with scratch
+ */
+typedef struct
+{
+  const RASTER_CONTEXT * ctx;
+  unsigned border;
+  RASTER_SCRATCH * scratch;
+  unsigned char * filled;
+  int filledStride;
+  size_t filledSize;
+  FLOOD_SEED * seeds;
+  int count, capacity;
+} FLOOD;
+
+/* Seeds that fit into scratch at first */
+#define FLOOD_MIN_SEEDS 256
+
+/* Places bitmap and stack in scratch of at least size bytes */
+static void placeFlood(FLOOD * flood, size_t size)
+{
+  flood->filled = flood->scratch->data;
+  flood->seeds = (FLOOD_SEED *)(flood->filled + flood->filledSize);
+  flood->capacity = (int)((size - flood->filledSize) / sizeof(FLOOD_SEED));
+}
+
+static int pushSeed(FLOOD * flood, int x, int y)
+{
+  size_t size;
+  if(flood->count == flood->capacity)
+  {
+    size = flood->filledSize + flood->capacity * 2 * sizeof(FLOOD_SEED);
+    if(RASTER_grow(flood->scratch, size) == NULL)
+      return 0;
+    placeFlood(flood, size);
+  }
+  flood->seeds[flood->count].x = x;
+  flood->seeds[flood->count].y = y;
+  flood->count++;
+  return 1;
+}
+
+/* Pixel (x, y) of row is not border and is not filled */
+static int floodable(const FLOOD * flood, const unsigned char * row, int x, int y)
+{
+  const RASTER_CONTEXT * ctx = flood->ctx;
+  int bit = x - ctx->clipLeft;
+  if(flood->filled[(y - ctx->clipTop) * flood->filledStride + (bit >> 3)] & (1 << (bit & 7)))
+    return 0;
+  if(ctx->surface.bpp == 32)
+    return ((const unsigned *)row)[x] != flood->border;
+  if(ctx->surface.bpp == 16)
+    return ((const unsigned short *)row)[x] != flood->border;
+  if(ctx->surface.bpp == 8)
+    return row[x] != flood->border;
+  return ((row[x >> 1] >> (x & 1 ? 0 : 4)) & 0xF) != flood->border;
+}
+
+static void markFilled(FLOOD * flood, int y, int x1, int x2)
+{
+  unsigned char * filled = flood->filled + (y - flood->ctx->clipTop) * flood->filledStride;
+  x1 -= flood->ctx->clipLeft;
+  x2 -= flood->ctx->clipLeft;
+  for(; x1 <= x2 && (x1 & 7) != 0; x1++)
+    filled[x1 >> 3] |= (unsigned char)(1 << (x1 & 7));
+  for(; x1 + 7 <= x2; x1 += 8)
+    filled[x1 >> 3] = 0xFF;
+  for(; x1 <= x2; x1++)
+    filled[x1 >> 3] |= (unsigned char)(1 << (x1 & 7));
+}
+
+/* Pushes one seed for every run of floodable pixels of row y in [x1, x2] */
+static int seedRow(FLOOD * flood, int y, int x1, int x2)
+{
+  const unsigned char * row = rowOf(&flood->ctx->surface, y);
+  int x, bit, run = 0, offset = (y - flood->ctx->clipTop) * flood->filledStride;
+  for(x = x1; x <= x2; x++)
+  {
+    /* filled pixels are skipped by 8 (row that span came from is filled mostly) */
+    bit = x - flood->ctx->clipLeft;
+    if((bit & 7) == 0 && x + 7 <= x2 && flood->filled[offset + (bit >> 3)] == 0xFF)
+    {
+      run = 0;
+      x += 7;
+      continue;
+    }
+    if(!floodable(flood, row, x, y))
+      run = 0;
+    else if(!run)
+    {
+      run = 1;
+      if(!pushSeed(flood, x, y))
+        return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * Scanline flood fill: every seed is extended to the widest span of
+ * floodable pixels, span is filled at once and runs of floodable pixels
+ * above and below it become seeds
+ */
+int RASTER_floodFill(const RASTER_CONTEXT * ctx, int x, int y, unsigned border)
+{
+  FLOOD flood;
+  RASTER_SCRATCH local = {NULL, 0};
+  const unsigned char * row;
+  int left, right, height, result = 1;
+  size_t size;
+
+  x += ctx->originX;
+  y += ctx->originY;
+  if(!INSIDE(ctx, x, y))
+    return 1;
+  flood.ctx = ctx;
+  flood.border = border;
+  flood.scratch = ctx->scratch != NULL ? ctx->scratch : &local;
+  flood.filledStride = (ctx->clipRight - ctx->clipLeft + 8) / 8;
+  height = ctx->clipBottom - ctx->clipTop + 1;
+  /* seeds are aligned */
+  flood.filledSize = (flood.filledStride * height + sizeof(FLOOD_SEED) - 1) / sizeof(FLOOD_SEED) * sizeof(FLOOD_SEED);
+  size = flood.filledSize + FLOOD_MIN_SEEDS * sizeof(FLOOD_SEED);
+  /* scratch left by previous calls is used whole */
+  if(flood.scratch->size > size)
+    size = flood.scratch->size;
+  if(RASTER_reserve(flood.scratch, size) == NULL)
+    return 0;
+  placeFlood(&flood, size);
+  memset(flood.filled, 0, flood.filledSize);
+  flood.count = 0;
+  pushSeed(&flood, x, y);
+  while(flood.count != 0)
+  {
+    flood.count--;
+    x = flood.seeds[flood.count].x;
+    y = flood.seeds[flood.count].y;
+    row = rowOf(&ctx->surface, y);
+    /* seed may be filled from other span after it was pushed */
+    if(!floodable(&flood, row, x, y))
+      continue;
+    for(left = x; left > ctx->clipLeft && floodable(&flood, row, left - 1, y); left--)
+      ;
+    for(right = x; right < ctx->clipRight && floodable(&flood, row, right + 1, y); right++)
+      ;
+    markFilled(&flood, y, left, right);
+    fillSpan(&ctx->surface, y, left, right, ctx->fillRows[y & 7]);
+    if((y > ctx->clipTop && !seedRow(&flood, y - 1, left, right)) ||
+       (y < ctx->clipBottom && !seedRow(&flood, y + 1, left, right)))
+    {
+      result = 0;
+      break;
+    }
+  }
+  RASTER_freeScratch(&local);
+  return result;
+}
+
+int RASTER_batchFields(int kind)
+{
+  static const int fields[] = {3, 5, 5, 4, 5};
+  return fields[kind];
+}
+
+static unsigned recordColor(const RASTER_CONTEXT * ctx, int color)
+{
+  return ctx->surface.bpp == 32 ? (unsigned)color : (unsigned)color & pixelMask(ctx->surface.bpp);
+}
+
+void RASTER_batch(const RASTER_CONTEXT * ctx, int kind, int count, const int * records)
+{
+  RASTER_CONTEXT local;
+  const int * r, * end = records + count * RASTER_batchFields(kind);
+  int x, y;
+  if(kind == RASTER_BATCH_PIXELS)
+  {
+    for(r = records; r != end; r += 3)
+    {
+      x = r[0] + ctx->originX;
+      y = r[1] + ctx->originY;
+      if(INSIDE(ctx, x, y))
+        plot(&ctx->surface, x, y, recordColor(ctx, r[2]), RASTER_COPY);
+    }
+    return;
+  }
+  /* context is copied once, fill rows are expanded again only when fill color changes */
+  local = *ctx;
+  for(r = records; r != end; r += RASTER_batchFields(kind))
+  {
+    switch(kind)
+    {
+    case RASTER_BATCH_LINES:
+      local.color = recordColor(ctx, r[4]);
+      RASTER_line(&local, r[0], r[1], r[2], r[3]);
+      break;
+    case RASTER_BATCH_CIRCLES:
+      local.color = recordColor(ctx, r[3]);
+      RASTER_ellipse(&local, r[0], r[1], 0, 360, r[2], r[2]);
+      break;
+    default:
+      if(local.fillColor != recordColor(ctx, r[4]))
+      {
+        local.fillColor = recordColor(ctx, r[4]);
+        RASTER_expandFill(&local);
+      }
+      if(kind == RASTER_BATCH_BARS)
+        RASTER_bar(&local, r[0], r[1], r[2], r[3]);
+      else
+        RASTER_fillEllipse(&local, r[0], r[1], r[2], r[3]);
+    }
+  }
+}
+
+/**
+ * Glyph cache of builtin font: every glyph row is a list of runs of set
+ * bits in font pixels. Vertical glyphs are turned counterclockwise and
+ * stored as rows too, from top to bottom. Runs do not depend on size or
+ * pixel format, text is drawn as one span of color per run and surface
+ * row.
+ */
+typedef struct
+{
+  unsigned char count;
+  unsigned char start[RASTER_FONT_SIZE / 2];
+  unsigned char length[RASTER_FONT_SIZE / 2];
+} GLYPH_ROW;
+
+static GLYPH_ROW glyphs[2][96][RASTER_FONT_SIZE];
+static int glyphsReady = 0;
+
+static void cacheRow(GLYPH_ROW * row, unsigned bits)
+{
+  int x = 0;
+  row->count = 0;
+  while(x != RASTER_FONT_SIZE)
+  {
+    if((bits & (1 << x)) == 0)
+    {
+      x++;
+      continue;
+    }
+    row->start[row->count] = (unsigned char)x;
+    while(x != RASTER_FONT_SIZE && (bits & (1 << x)) != 0)
+      x++;
+    row->length[row->count] = (unsigned char)(x - row->start[row->count]);
+    row->count++;
+  }
+}
+
+void RASTER_initFont(void)
+{
+  int c, gx, gy;
+  unsigned column;
+  if(glyphsReady)
+    return;
+  for(c = 0; c != 96; c++)
+  {
+    for(gy = 0; gy != RASTER_FONT_SIZE; gy++)
+      cacheRow(&glyphs[0][c][gy], font8x8[c][gy]);
+    /* column gx of glyph is row 7 - gx of vertical glyph, glyph rows become its columns */
+    for(gx = 0; gx != RASTER_FONT_SIZE; gx++)
+    {
+      column = 0;
+      for(gy = 0; gy != RASTER_FONT_SIZE; gy++)
+        if(font8x8[c][gy] & (1 << gx))
+          column |= 1 << gy;
+      cacheRow(&glyphs[1][c][RASTER_FONT_SIZE - 1 - gx], column);
+    }
+  }
+  glyphsReady = 1;
+}
+
+/* Glyph with top left corner (left, top) in surface coordinates, partially inside clip rectangle */
+static void drawGlyph(const RASTER_CONTEXT * ctx, const GLYPH_ROW * rows, int left, int top, int size)
+{
+  int gy, i, x1, x2, y, y1, y2;
+  for(gy = 0; gy != RASTER_FONT_SIZE; gy++)
+  {
+    y1 = top + gy * size;
+    y2 = y1 + size - 1;
+    if(y1 < ctx->clipTop)
+      y1 = ctx->clipTop;
+    if(y2 > ctx->clipBottom)
+      y2 = ctx->clipBottom;
+    for(i = 0; i != rows[gy].count; i++)
+    {
+      x1 = left + rows[gy].start[i] * size;
+      x2 = x1 + rows[gy].length[i] * size - 1;
+      if(x1 < ctx->clipLeft)
+        x1 = ctx->clipLeft;
+      if(x2 > ctx->clipRight)
+        x2 = ctx->clipRight;
+      if(x1 > x2)
+        continue;
+      for(y = y1; y <= y2; y++)
+        horizontalSpan(&ctx->surface, y, x1, x2, ctx->color, RASTER_COPY);
+    }
+  }
+}
+
+void RASTER_text(const RASTER_CONTEXT * ctx, int x, int y, const char * text, int size, int vertical)
+{
+  int i, left, top, step = RASTER_FONT_SIZE * size;
+  unsigned char c;
+  x += ctx->originX;
+  y += ctx->originY;
+  for(i = 0; text[i] != 0; i++)
+  {
+    c = (unsigned char)text[i];
+    /* vertical text goes up from (x, y) that is its bottom left corner */
+    left = vertical ? x : x + i * step;
+    top = vertical ? y - (i + 1) * step + 1 : y;
+    if(left > ctx->clipRight || top > ctx->clipBottom || left + step <= ctx->clipLeft || top + step <= ctx->clipTop)
+      continue;
+    drawGlyph(ctx, glyphs[vertical != 0][c >= 0x20 && c < 0x80 ? c - 0x20 : '?' - 0x20], left, top, size);
+  }
+}
@@ -0,0 +1,176 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __RASTER_H__
+#define __RASTER_H__
+
+#include "Span.h"
+
+/**
+ * Software rasterizer. Draws into plain memory that has the same layout
+ * as pages created by BGI_createPage (bottom-up rows aligned to DWORD,
+ * packed 4bpp, 8bpp, 16bpp or 32bpp pixels), so it does not need GDI at all.
+ */
+
+/* Write modes and operations of images (same values as putimage_ops) */
+#define RASTER_COPY 0
+#define RASTER_XOR  1
+#define RASTER_OR   2
+#define RASTER_AND  3
+#define RASTER_NOT  4
+
+/* Fill rules of polygons */
+#define RASTER_EVENODD 0
+#define RASTER_NONZERO 1
+
+#define RASTER_FONT_SIZE 8
+
+/* Line pattern of solid lines */
+#define RASTER_SOLID_LINE 0xFFFF
+
+/**
+ * Memory that primitives are drawn on
+ */
+typedef struct
+{
+  unsigned char * bits;
+  int width, height;
+  int stride;
+  int bpp;
+} RASTER_SURFACE;
+
+/**
+ * Temporary memory of primitives, it grows and is kept between them
+ */
+typedef struct
+{
+  void * data;
+  size_t size;
+} RASTER_SCRATCH;
+
+/**
+ * Drawing state. Coordinates passed to RASTER_* primitives are relative
+ * to (originX, originY) and are clipped by the (inclusive) clip rectangle
+ * given in surface coordinates. Colors are in surface pixel format.
+ */
+typedef struct
+{
+  RASTER_SURFACE surface;
+  int clipLeft, clipTop, clipRight, clipBottom;
+  int originX, originY;
+  unsigned color;
+  unsigned fillColor;
+  unsigned backColor;
+  int writeMode;
+  /* set bits are drawn with fillColor, others with backColor */
+  unsigned char fillPattern[8];
+  /* pixels of line with set bits are drawn, bit 0 is first one, pattern repeats every 16 pixels */
+  unsigned linePattern;
+  /* 1, or 3 for thick lines (they are drawn as three parallel lines) */
+  int lineWidth;
+  int fillRule;
+  /* memory of thread that draws with context, if NULL primitives allocate it every time */
+  RASTER_SCRATCH * scratch;
+  /* fill pattern rows expanded to surface pixels for SPAN_fill (by RASTER_expandFill), must be last */
+  unsigned char fillRows[8][2 * SPAN_PERIOD];
+} RASTER_CONTEXT;
+
+/**
+ * Image compiled for drawing with transparent color: every row is a list
+ * of runs of opaque pixels stored in surface pixel format. Sprite is one
+ * block of memory without pointers (rows, runs and pixels follow the
+ * header), so it may be copied as is.
+ */
+typedef struct
+{
+  /* bytes in sprite with this header, multiple of 4 */
+  unsigned size;
+  int width, height;
+  int bpp;
+  int runCount;
+} RASTER_SPRITE;
+
+/* Returns size in bytes of one surface row */
+int RASTER_stride(int width, int bpp);
+/* Describes surface memory */
+void RASTER_initSurface(RASTER_SURFACE * surface, void * bits, int width, int height, int bpp);
+/* Returns at least size bytes of scratch (previous content is lost), or NULL if there is no memory */
+void * RASTER_reserve(RASTER_SCRATCH * scratch, size_t size);
+/* Same as RASTER_reserve, but content is kept, scratch is not changed if there is no memory */
+void * RASTER_grow(RASTER_SCRATCH * scratch, size_t size);
+void RASTER_freeScratch(RASTER_SCRATCH * scratch);
+/* Expands fill pattern to fillRows, must be called when pattern, fill or back color or surface format is changed */
+void RASTER_expandFill(RASTER_CONTEXT * ctx);
+
+void RASTER_putPixel(const RASTER_CONTEXT * ctx, int x, int y, unsigned color, int op);
+unsigned RASTER_getPixel(const RASTER_CONTEXT * ctx, int x, int y);
+/* Combines width x height pixels given row by row with surface by op */
+void RASTER_putImage(const RASTER_CONTEXT * ctx, int left, int top, int width, int height, const unsigned * colors, int op);
+/* Reads width x height pixels row by row, pixels outside surface are 0 */
+void RASTER_getImage(const RASTER_CONTEXT * ctx, int left, int top, int width, int height, unsigned * colors);
+/* Compiles image of pixels equal to key are transparent for bpp surfaces, returns NULL if there is no memory */
+RASTER_SPRITE * RASTER_createSprite(const unsigned * colors, int width, int height, unsigned key, int bpp);
+void RASTER_freeSprite(RASTER_SPRITE * sprite);
+/* Copies opaque pixels of sprite compiled for bpp of surface */
+void RASTER_drawSprite(const RASTER_CONTEXT * ctx, int left, int top, const RASTER_SPRITE * sprite);
+/* Fills rectangle with one color, ignoring fill pattern */
+void RASTER_clear(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom, unsigned color);
+/* Fills rectangle with current fill pattern */
+void RASTER_bar(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom);
+/* Draws line with color, write mode, pattern and width of context */
+void RASTER_line(const RASTER_CONTEXT * ctx, int x1, int y1, int x2, int y2);
+void RASTER_rectangle(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom);
+/* Point of ellipse at angle that arcs start or end at, origin is not added */
+void RASTER_arcPoint(int x, int y, int angle, int xradius, int yradius, int * px, int * py);
+/* Draws elliptic arc, angles are in degrees counterclockwise from 3 o'clock */
+void RASTER_ellipse(const RASTER_CONTEXT * ctx, int x, int y, int stangle, int endangle, int xradius, int yradius);
+void RASTER_fillEllipse(const RASTER_CONTEXT * ctx, int x, int y, int xradius, int yradius);
+/* Draws filled and outlined elliptic sector */
+void RASTER_sector(const RASTER_CONTEXT * ctx, int x, int y, int stangle, int endangle, int xradius, int yradius);
+/* Fills polygon by fill rule of context, points are given as x,y pairs */
+void RASTER_fillPoly(const RASTER_CONTEXT * ctx, int numpoints, const int * points);
+/* Fills area around (x, y) bounded by border color with fill pattern. Returns 0 if there is no memory */
+int RASTER_floodFill(const RASTER_CONTEXT * ctx, int x, int y, unsigned border);
+/**
+ * Batches are count records of packed ints, last int of record is its
+ * color (low 4, 8 or 16 bits are used on 4bpp, 8bpp or 16bpp surfaces). It replaces color of
+ * context for pixels, lines and circles and fill color for bars and
+ * filled ellipses, everything else is taken from context:
+ * PIXELS       - x, y, color (COPY)
+ * LINES        - x1, y1, x2, y2, color
+ * BARS         - left, top, right, bottom, color
+ * CIRCLES      - x, y, radius, color
+ * FILLELLIPSES - x, y, xradius, yradius, color
+ */
+#define RASTER_BATCH_PIXELS       0
+#define RASTER_BATCH_LINES        1
+#define RASTER_BATCH_BARS         2
+#define RASTER_BATCH_CIRCLES      3
+#define RASTER_BATCH_FILLELLIPSES 4
+
+/* Ints in one record of batch */
+int RASTER_batchFields(int kind);
+/* Draws records of batch in order */
+void RASTER_batch(const RASTER_CONTEXT * ctx, int kind, int count, const int * records);
+/* Builds glyph cache of builtin font, must be called in every process before any of its threads draws text */
+void RASTER_initFont(void);
+/* Draws string with builtin 8x8 font scaled by size, (x, y) is top left corner (bottom left for vertical text) */
+void RASTER_text(const RASTER_CONTEXT * ctx, int x, int y, const char * text, int size, int vertical);
+
+#endif
@@ -0,0 +1,628 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Render.h"
+#include "IPC.h"
+#include "Atomic.h"
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+
+#define RENDER_CMD_WRAP        1
+#define RENDER_CMD_STOP        2
+#define RENDER_CMD_CONTEXT     3
+#define RENDER_CMD_SHOWPAGE    4
+#define RENDER_CMD_PUTPIXEL    5
+#define RENDER_CMD_PUTIMAGE    6
+#define RENDER_CMD_CLEAR       7
+#define RENDER_CMD_BAR         8
+#define RENDER_CMD_LINE        9
+#define RENDER_CMD_RECTANGLE   10
+#define RENDER_CMD_ELLIPSE     11
+#define RENDER_CMD_FILLELLIPSE 12
+#define RENDER_CMD_SECTOR      13
+#define RENDER_CMD_FILLPOLY    14
+#define RENDER_CMD_TEXT        15
+#define RENDER_CMD_DAMAGE      16
+#define RENDER_CMD_PRESENT     17
+#define RENDER_CMD_SPRITE      18
+#define RENDER_CMD_PIXEL       19
+#define RENDER_CMD_BATCH       20
+
+/* First word of command: type and length in words (with this word) */
+#define HEADER(TYPE, LENGTH) ((unsigned)(TYPE) | ((unsigned)(LENGTH) << 8))
+#define HEADER_TYPE(H) ((H) & 0xFF)
+#define HEADER_LENGTH(H) ((H) >> 8)
+
+/* Commands longer than this are not recorded, they are drawn at once */
+#define MAX_COMMAND (RENDER_QUEUE_WORDS / 2)
+/* How many times side checks counter before going to sleep */
+#define SPIN_COUNT 200
+/**
+ * Sleeping render thread is woken when this many words are waiting or
+ * when somebody needs drawn result (RENDER_flush, RENDER_wait). Waking
+ * it for every primitive costs more than drawing small primitives.
+ */
+#define WAKE_WORDS (RENDER_QUEUE_WORDS / 16)
+
+/* Header and fields of context */
+#define CONTEXT_WORDS 17
+#define WORDS_FOR_CHARS(N) (((N) + 4) / 4)
+
+/* Counters grow infinitely, so they are compared by difference */
+#define PASSED(COUNTER, FENCE) ((int)((COUNTER) - (FENCE)) >= 0)
+
+/* Raster.c draws at once, there is nothing to wait for */
+static void finishDirect(void)
+{
+}
+
+const RENDER_TARGET RENDER_direct = 
+{
+  RASTER_putPixel,
+  RASTER_putImage,
+  RASTER_drawSprite,
+  RASTER_clear,
+  RASTER_bar,
+  RASTER_line,
+  RASTER_rectangle,
+  RASTER_ellipse,
+  RASTER_fillEllipse,
+  RASTER_sector,
+  RASTER_fillPoly,
+  RASTER_floodFill,
+  RASTER_text,
+  RASTER_batch,
+  finishDirect
+};
+
+/* Client side state */
+static struct
+{
+  RENDER_QUEUE * queue;
+  HANDLE commandEvent;
+  HANDLE doneEvent;
+  void * pageBits[BGI_MAX_PAGES];
+  int pageCount;
+  /* head including command that is being written */
+  unsigned head;
+  /* context of last recorded command */
+  RASTER_CONTEXT context;
+  int contextValid;
+} recorder;
+
+/* Wakes render thread if it sleeps */
+static void wakePlayer(void)
+{
+  RENDER_QUEUE * queue = recorder.queue;
+  if(queue->playerSleeping && ATOMIC_exchange(&queue->playerSleeping, 0))
+    IPC_raiseEvent(recorder.commandEvent);
+}
+
+/* Makes recorded commands visible to render thread, wakes it if enough of them are waiting */
+static void publish(void)
+{
+  RENDER_QUEUE * queue = recorder.queue;
+  /* exchange is full barrier: head is stored before playerSleeping is read */
+  ATOMIC_exchange(&queue->head, recorder.head);
+  if(queue->playerSleeping && recorder.head - queue->tail >= WAKE_WORDS)
+    wakePlayer();
+}
+
+void RENDER_wait(unsigned fence)
+{
+  RENDER_QUEUE * queue = recorder.queue;
+  int spin = 0;
+  if(queue == NULL)
+    return;
+  while(!PASSED(ATOMIC_loadAcquire(&queue->tail), fence))
+  {
+    /* render thread may sleep with commands before fence */
+    if(spin == 0)
+      wakePlayer();
+    if(spin++ < SPIN_COUNT)
+      continue;
+    ATOMIC_exchange(&queue->recorderSleeping, 1);
+    if(PASSED(ATOMIC_loadAcquire(&queue->tail), fence))
+    {
+      ATOMIC_exchange(&queue->recorderSleeping, 0);
+      break;
+    }
+    IPC_waitEvent(recorder.doneEvent);
+  }
+}
+
+unsigned RENDER_flush(void)
+{
+  /* woken render thread would only spin if everything is drawn */
+  if(recorder.head != ATOMIC_loadAcquire(&recorder.queue->tail))
+    wakePlayer();
+  return recorder.head;
+}
+
+void RENDER_finish(void)
+{
+  RENDER_wait(RENDER_flush());
+}
+
+/* Returns place for command arguments, length is in words with header */
+static unsigned * reserve(int type, unsigned length)
+{
+  RENDER_QUEUE * queue = recorder.queue;
+  unsigned offset = recorder.head & (RENDER_QUEUE_WORDS - 1);
+  if(offset + length > RENDER_QUEUE_WORDS)
+  {
+    /* command must not be split, rest of ring is skipped */
+    RENDER_wait(recorder.head - offset);
+    queue->words[offset] = HEADER(RENDER_CMD_WRAP, RENDER_QUEUE_WORDS - offset);
+    recorder.head += RENDER_QUEUE_WORDS - offset;
+    publish();
+    offset = 0;
+  }
+  /* wait until render thread frees enough place */
+  RENDER_wait(recorder.head + length - RENDER_QUEUE_WORDS);
+  queue->words[offset] = HEADER(type, length);
+  return queue->words + offset + 1;
+}
+
+static void commit(unsigned length)
+{
+  recorder.head += length;
+  publish();
+}
+
+static void recordContext(const RASTER_CONTEXT * ctx)
+{
+  unsigned * p;
+  int page = 0;
+  /* expanded fill rows follow from other fields */
+  if(recorder.contextValid && memcmp(ctx, &recorder.context, offsetof(RASTER_CONTEXT, fillRows)) == 0)
+    return;
+  /* addresses of pages are different in render thread, index is recorded */
+  while(page != recorder.pageCount - 1 && ctx->surface.bits != recorder.pageBits[page])
+    page++;
+  p = reserve(RENDER_CMD_CONTEXT, CONTEXT_WORDS);
+  p[0] = page;
+  p[1] = ctx->clipLeft;
+  p[2] = ctx->clipTop;
+  p[3] = ctx->clipRight;
+  p[4] = ctx->clipBottom;
+  p[5] = ctx->originX;
+  p[6] = ctx->originY;
+  p[7] = ctx->color;
+  p[8] = ctx->fillColor;
+  p[9] = ctx->backColor;
+  p[10] = ctx->writeMode;
+  memcpy(p + 11, ctx->fillPattern, sizeof(ctx->fillPattern));
+  p[13] = ctx->linePattern;
+  p[14] = ctx->lineWidth;
+  p[15] = ctx->fillRule;
+  commit(CONTEXT_WORDS);
+  recorder.context = *ctx;
+  recorder.contextValid = 1;
+}
+
+/* Reserves command that draws with ctx */
+static unsigned * begin(const RASTER_CONTEXT * ctx, int type, unsigned length)
+{
+  recordContext(ctx);
+  return reserve(type, length);
+}
+
+static void recordPutPixel(const RASTER_CONTEXT * ctx, int x, int y, unsigned color, int op)
+{
+  unsigned * p = begin(ctx, RENDER_CMD_PUTPIXEL, 5);
+  p[0] = x;
+  p[1] = y;
+  p[2] = color;
+  p[3] = op;
+  commit(5);
+}
+
+static void recordPutImage(const RASTER_CONTEXT * ctx, int left, int top, int width, int height, const unsigned * colors, int op)
+{
+  unsigned length = 6 + width * height, * p;
+  if(width <= 0 || height <= 0)
+    return;
+  if(length > MAX_COMMAND)
+  {
+    RENDER_finish();
+    RASTER_putImage(ctx, left, top, width, height, colors, op);
+    return;
+  }
+  p = begin(ctx, RENDER_CMD_PUTIMAGE, length);
+  p[0] = left;
+  p[1] = top;
+  p[2] = width;
+  p[3] = height;
+  p[4] = op;
+  memcpy(p + 5, colors, width * height * sizeof(unsigned));
+  commit(length);
+}
+
+/* Sprite has no pointers, it is copied into command as is */
+static void recordDrawSprite(const RASTER_CONTEXT * ctx, int left, int top, const RASTER_SPRITE * sprite)
+{
+  unsigned length = 3 + sprite->size / 4, * p;
+  if(length > MAX_COMMAND)
+  {
+    RENDER_finish();
+    RASTER_drawSprite(ctx, left, top, sprite);
+    return;
+  }
+  p = begin(ctx, RENDER_CMD_SPRITE, length);
+  p[0] = left;
+  p[1] = top;
+  memcpy(p + 2, sprite, sprite->size);
+  commit(length);
+}
+
+/* Commands that have 4 int arguments */
+static void record4(const RASTER_CONTEXT * ctx, int type, int a, int b, int c, int d)
+{
+  unsigned * p = begin(ctx, type, 5);
+  p[0] = a;
+  p[1] = b;
+  p[2] = c;
+  p[3] = d;
+  commit(5);
+}
+
+/* Commands that have 6 int arguments */
+static void record6(const RASTER_CONTEXT * ctx, int type, int a, int b, int c, int d, int e, int f)
+{
+  unsigned * p = begin(ctx, type, 7);
+  p[0] = a;
+  p[1] = b;
+  p[2] = c;
+  p[3] = d;
+  p[4] = e;
+  p[5] = f;
+  commit(7);
+}
+
+static void recordClear(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom, unsigned color)
+{
+  unsigned * p = begin(ctx, RENDER_CMD_CLEAR, 6);
+  p[0] = left;
+  p[1] = top;
+  p[2] = right;
+  p[3] = bottom;
+  p[4] = color;
+  commit(6);
+}
+
+static void recordBar(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom)
+{
+  record4(ctx, RENDER_CMD_BAR, left, top, right, bottom);
+}
+
+static void recordLine(const RASTER_CONTEXT * ctx, int x1, int y1, int x2, int y2)
+{
+  record4(ctx, RENDER_CMD_LINE, x1, y1, x2, y2);
+}
+
+static void recordRectangle(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom)
+{
+  record4(ctx, RENDER_CMD_RECTANGLE, left, top, right, bottom);
+}
+
+static void recordEllipse(const RASTER_CONTEXT * ctx, int x, int y, int stangle, int endangle, int xradius, int yradius)
+{
+  record6(ctx, RENDER_CMD_ELLIPSE, x, y, stangle, endangle, xradius, yradius);
+}
+
+static void recordFillEllipse(const RASTER_CONTEXT * ctx, int x, int y, int xradius, int yradius)
+{
+  record4(ctx, RENDER_CMD_FILLELLIPSE, x, y, xradius, yradius);
+}
+
+static void recordSector(const RASTER_CONTEXT * ctx, int x, int y, int stangle, int endangle, int xradius, int yradius)
+{
+  record6(ctx, RENDER_CMD_SECTOR, x, y, stangle, endangle, xradius, yradius);
+}
+
+static void recordFillPoly(const RASTER_CONTEXT * ctx, int numpoints, const int * points)
+{
+  unsigned length = 2 + 2 * numpoints, * p;
+  if(numpoints <= 0)
+    return;
+  if(length > MAX_COMMAND)
+  {
+    RENDER_finish();
+    RASTER_fillPoly(ctx, numpoints, points);
+    return;
+  }
+  p = begin(ctx, RENDER_CMD_FILLPOLY, length);
+  p[0] = numpoints;
+  memcpy(p + 1, points, 2 * numpoints * sizeof(int));
+  commit(length);
+}
+
+/* Flood fill reads page and reports result, so it is not recorded but drawn at once */
+static int recordFloodFill(const RASTER_CONTEXT * ctx, int x, int y, unsigned border)
+{
+  RENDER_finish();
+  return RASTER_floodFill(ctx, x, y, border);
+}
+
+static void recordText(const RASTER_CONTEXT * ctx, int x, int y, const char * text, int size, int vertical)
+{
+  unsigned n = (unsigned)strlen(text), length = 5 + WORDS_FOR_CHARS(n), * p;
+  if(length > MAX_COMMAND)
+  {
+    RENDER_finish();
+    RASTER_text(ctx, x, y, text, size, vertical);
+    return;
+  }
+  p = begin(ctx, RENDER_CMD_TEXT, length);
+  p[0] = x;
+  p[1] = y;
+  p[2] = size;
+  p[3] = vertical;
+  memcpy(p + 4, text, n + 1);
+  commit(length);
+}
+
+/* Records are independent, long batch is recorded as several commands instead of being drawn at once */
+static void recordBatch(const RASTER_CONTEXT * ctx, int kind, int count, const int * records)
+{
+  int fields = RASTER_batchFields(kind), n;
+  int most = (MAX_COMMAND - 3) / fields;
+  unsigned length, * p;
+  while(count > 0)
+  {
+    n = count < most ? count : most;
+    length = 3 + n * fields;
+    p = begin(ctx, RENDER_CMD_BATCH, length);
+    p[0] = kind;
+    p[1] = n;
+    memcpy(p + 2, records, n * fields * sizeof(int));
+    commit(length);
+    records += n * fields;
+    count -= n;
+  }
+}
+
+unsigned RENDER_showPage(int page)
+{
+  unsigned * p = reserve(RENDER_CMD_SHOWPAGE, 2);
+  p[0] = page;
+  commit(2);
+  return RENDER_flush();
+}
+
+void RENDER_present(void)
+{
+  reserve(RENDER_CMD_PRESENT, 1);
+  commit(1);
+  RENDER_flush();
+}
+
+void RENDER_putPixel(const RASTER_CONTEXT * ctx, int page, int x, int y, unsigned color)
+{
+  unsigned * p = begin(ctx, RENDER_CMD_PIXEL, 5);
+  p[0] = page;
+  p[1] = x;
+  p[2] = y;
+  p[3] = color;
+  commit(5);
+}
+
+void RENDER_damage(int page, int left, int top, int right, int bottom)
+{
+  unsigned * p = reserve(RENDER_CMD_DAMAGE, 6);
+  p[0] = page;
+  p[1] = left;
+  p[2] = top;
+  p[3] = right;
+  p[4] = bottom;
+  commit(6);
+}
+
+const RENDER_TARGET RENDER_recorder = 
+{
+  recordPutPixel,
+  recordPutImage,
+  recordDrawSprite,
+  recordClear,
+  recordBar,
+  recordLine,
+  recordRectangle,
+  recordEllipse,
+  recordFillEllipse,
+  recordSector,
+  recordFillPoly,
+  recordFloodFill,
+  recordText,
+  recordBatch,
+  RENDER_finish
+};
+
+void RENDER_startRecording(RENDER_QUEUE * queue, HANDLE commandEvent, HANDLE doneEvent, void * pageBits[], int pageCount)
+{
+  recorder.queue = queue;
+  recorder.commandEvent = commandEvent;
+  recorder.doneEvent = doneEvent;
+  memcpy(recorder.pageBits, pageBits, pageCount * sizeof(pageBits[0]));
+  recorder.pageCount = pageCount;
+  recorder.head = queue->head;
+  recorder.contextValid = 0;
+}
+
+void RENDER_stopRecording(void)
+{
+  if(recorder.queue == NULL)
+    return;
+  reserve(RENDER_CMD_STOP, 1);
+  commit(1);
+  RENDER_finish();
+  recorder.queue = NULL;
+}
+
+/* Render thread side */
+
+/* Waits for commands. Calls present before going to sleep if there is new damage */
+static void waitCommands(RENDER_PLAYER * player, unsigned tail, int * drawn)
+{
+  RENDER_QUEUE * queue = player->queue;
+  int spin = 0;
+  while(tail == ATOMIC_loadAcquire(&queue->head))
+  {
+    if(spin++ < SPIN_COUNT)
+      continue;
+    if(*drawn)
+    {
+      *drawn = 0;
+      player->present(0);
+    }
+    ATOMIC_exchange(&queue->playerSleeping, 1);
+    if(tail != ATOMIC_loadAcquire(&queue->head))
+    {
+      ATOMIC_exchange(&queue->playerSleeping, 0);
+      break;
+    }
+    IPC_waitEvent(player->commandEvent);
+  }
+}
+
+static void loadContext(RENDER_PLAYER * player, RASTER_CONTEXT * ctx, const unsigned * p)
+{
+  ctx->surface = player->surfaces[p[0] % BGI_MAX_PAGES];
+  ctx->clipLeft = p[1];
+  ctx->clipTop = p[2];
+  ctx->clipRight = p[3];
+  ctx->clipBottom = p[4];
+  ctx->originX = p[5];
+  ctx->originY = p[6];
+  ctx->color = p[7];
+  ctx->fillColor = p[8];
+  ctx->backColor = p[9];
+  ctx->writeMode = p[10];
+  memcpy(ctx->fillPattern, p + 11, sizeof(ctx->fillPattern));
+  ctx->linePattern = p[13];
+  ctx->lineWidth = p[14];
+  ctx->fillRule = p[15];
+  RASTER_expandFill(ctx);
+}
+
+void RENDER_play(RENDER_PLAYER * player)
+{
+  RENDER_QUEUE * queue = player->queue;
+  RASTER_CONTEXT ctx;
+  RASTER_SCRATCH scratch = {NULL, 0};
+  unsigned tail = queue->tail, header;
+  const unsigned * p;
+  const int * a;
+  int drawn = 0, x, y;
+
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.surface = player->surfaces[0];
+  ctx.scratch = &scratch;
+  for(;;)
+  {
+    waitCommands(player, tail, &drawn);
+    header = queue->words[tail & (RENDER_QUEUE_WORDS - 1)];
+    p = queue->words + (tail & (RENDER_QUEUE_WORDS - 1)) + 1;
+    a = (const int *)p;
+    switch(HEADER_TYPE(header))
+    {
+    case RENDER_CMD_WRAP:
+      break;
+    case RENDER_CMD_STOP:
+      RASTER_freeScratch(&scratch);
+      ATOMIC_exchange(&queue->tail, tail + HEADER_LENGTH(header));
+      if(queue->recorderSleeping && ATOMIC_exchange(&queue->recorderSleeping, 0))
+        IPC_raiseEvent(player->doneEvent);
+      return;
+    case RENDER_CMD_CONTEXT:
+      loadContext(player, &ctx, p);
+      break;
+    case RENDER_CMD_SHOWPAGE:
+      player->showPage(a[0]);
+      player->present(0);
+      drawn = 0;
+      break;
+    case RENDER_CMD_PUTPIXEL:
+      RASTER_putPixel(&ctx, a[0], a[1], p[2], a[3]);
+      break;
+    case RENDER_CMD_PIXEL:
+      RASTER_putPixel(&ctx, a[1], a[2], p[3], RASTER_COPY);
+      x = a[1] + ctx.originX;
+      y = a[2] + ctx.originY;
+      if(x >= ctx.clipLeft && x <= ctx.clipRight && y >= ctx.clipTop && y <= ctx.clipBottom)
+      {
+        player->damage(a[0], x, y, x + 1, y + 1);
+        drawn = 1;
+      }
+      break;
+    case RENDER_CMD_PUTIMAGE:
+      RASTER_putImage(&ctx, a[0], a[1], a[2], a[3], p + 5, a[4]);
+      break;
+    case RENDER_CMD_SPRITE:
+      RASTER_drawSprite(&ctx, a[0], a[1], (const RASTER_SPRITE *)(p + 2));
+      break;
+    case RENDER_CMD_CLEAR:
+      RASTER_clear(&ctx, a[0], a[1], a[2], a[3], p[4]);
+      break;
+    case RENDER_CMD_BAR:
+      RASTER_bar(&ctx, a[0], a[1], a[2], a[3]);
+      break;
+    case RENDER_CMD_LINE:
+      RASTER_line(&ctx, a[0], a[1], a[2], a[3]);
+      break;
+    case RENDER_CMD_RECTANGLE:
+      RASTER_rectangle(&ctx, a[0], a[1], a[2], a[3]);
+      break;
+    case RENDER_CMD_ELLIPSE:
+      RASTER_ellipse(&ctx, a[0], a[1], a[2], a[3], a[4], a[5]);
+      break;
+    case RENDER_CMD_FILLELLIPSE:
+      RASTER_fillEllipse(&ctx, a[0], a[1], a[2], a[3]);
+      break;
+    case RENDER_CMD_SECTOR:
+      RASTER_sector(&ctx, a[0], a[1], a[2], a[3], a[4], a[5]);
+      break;
+    case RENDER_CMD_FILLPOLY:
+      RASTER_fillPoly(&ctx, a[0], a + 1);
+      break;
+    case RENDER_CMD_TEXT:
+      RASTER_text(&ctx, a[0], a[1], (const char *)(p + 4), a[2], a[3]);
+      break;
+    case RENDER_CMD_BATCH:
+      RASTER_batch(&ctx, a[0], a[1], a + 2);
+      break;
+    case RENDER_CMD_DAMAGE:
+      player->damage(a[0], a[1], a[2], a[3], a[4]);
+      drawn = 1;
+      break;
+    case RENDER_CMD_PRESENT:
+      player->present(1);
+      drawn = 0;
+      break;
+    default:
+      assert(0);
+    }
+    tail += HEADER_LENGTH(header);
+    /* command is drawn, its place can be reused */
+    ATOMIC_exchange(&queue->tail, tail);
+    if(queue->recorderSleeping && ATOMIC_exchange(&queue->recorderSleeping, 0))
+      IPC_raiseEvent(player->doneEvent);
+  }
+}
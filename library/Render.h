@@ -0,0 +1,132 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __RENDER_H__
+#define __RENDER_H__
+
+#include "BGI.H"
+#include "Raster.h"
+
+/**
+ * Pipelined rendering (MODE_PIPELINE). Client does not rasterize
+ * primitives itself but encodes them into command ring in shared
+ * memory, render thread (in server, or in client process in headless
+ * mode) decodes and draws them into pages. So application logic and
+ * rasterization run in parallel.
+ *
+ * graphics.c draws through RENDER_TARGET: RENDER_direct draws at once
+ * by Raster.c, RENDER_recorder writes commands.
+ */
+
+/* Ring size in 32-bit words, must be power of 2 */
+#define RENDER_QUEUE_WORDS (1 << 18)
+#define RENDER_CACHE_LINE 64
+
+/**
+ * Command ring. It is single-producer/single-consumer queue of
+ * variable-size commands, commands never wrap around the end.
+ * Counters are in words and grow infinitely. Render thread moves
+ * tail only after command is drawn, so when tail reaches some head
+ * value everything written before is on the page: that head value
+ * is a fence.
+ */
+typedef struct
+{
+  volatile unsigned head;
+  char headPad[RENDER_CACHE_LINE - sizeof(unsigned)];
+  volatile unsigned tail;
+  char tailPad[RENDER_CACHE_LINE - sizeof(unsigned)];
+  /* set by side that is going to wait for event */
+  volatile unsigned playerSleeping;
+  volatile unsigned recorderSleeping;
+  unsigned words[RENDER_QUEUE_WORDS];
+} RENDER_QUEUE;
+
+/**
+ * Primitives of Raster.h that graphics.c uses.
+ * finish makes pages up to date (before they are read or shown).
+ */
+typedef struct
+{
+  void (*putPixel)(const RASTER_CONTEXT * ctx, int x, int y, unsigned color, int op);
+  void (*putImage)(const RASTER_CONTEXT * ctx, int left, int top, int width, int height, const unsigned * colors, int op);
+  void (*drawSprite)(const RASTER_CONTEXT * ctx, int left, int top, const RASTER_SPRITE * sprite);
+  void (*clear)(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom, unsigned color);
+  void (*bar)(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom);
+  void (*line)(const RASTER_CONTEXT * ctx, int x1, int y1, int x2, int y2);
+  void (*rectangle)(const RASTER_CONTEXT * ctx, int left, int top, int right, int bottom);
+  void (*ellipse)(const RASTER_CONTEXT * ctx, int x, int y, int stangle, int endangle, int xradius, int yradius);
+  void (*fillEllipse)(const RASTER_CONTEXT * ctx, int x, int y, int xradius, int yradius);
+  void (*sector)(const RASTER_CONTEXT * ctx, int x, int y, int stangle, int endangle, int xradius, int yradius);
+  void (*fillPoly)(const RASTER_CONTEXT * ctx, int numpoints, const int * points);
+  int (*floodFill)(const RASTER_CONTEXT * ctx, int x, int y, unsigned border);
+  void (*text)(const RASTER_CONTEXT * ctx, int x, int y, const char * text, int size, int vertical);
+  void (*batch)(const RASTER_CONTEXT * ctx, int kind, int count, const int * records);
+  void (*finish)(void);
+} RENDER_TARGET;
+
+extern const RENDER_TARGET RENDER_direct;
+extern const RENDER_TARGET RENDER_recorder;
+
+/**
+ * State of render thread
+ */
+typedef struct
+{
+  RENDER_QUEUE * queue;
+  /* raised by recorder when commands are added and player sleeps */
+  HANDLE commandEvent;
+  /* raised by player when it moved tail and recorder sleeps */
+  HANDLE doneEvent;
+  /* pages, index of page is encoded in commands */
+  RASTER_SURFACE surfaces[BGI_MAX_PAGES];
+  /* makes page visible (setvisualpage is recorded too) */
+  void (*showPage)(int page);
+  /* marks rectangle of page as drawn (right and bottom are exclusive) */
+  void (*damage)(int page, int left, int top, int right, int bottom);
+  /**
+   * Called with 0 after page is shown and when all commands are drawn,
+   * if something was drawn. Called with 1 for RENDER_present
+   */
+  void (*present)(int explicitly);
+} RENDER_PLAYER;
+
+/* Render thread procedure. Draws commands until recorder stops */
+void RENDER_play(RENDER_PLAYER * player);
+
+/* Client side: starts encoding to queue. pageBits are client addresses of pageCount pages */
+void RENDER_startRecording(RENDER_QUEUE * queue, HANDLE commandEvent, HANDLE doneEvent, void * pageBits[], int pageCount);
+/* Draws everything, stops render thread */
+void RENDER_stopRecording(void);
+/* Returns fence for all commands written so far and wakes render thread */
+unsigned RENDER_flush(void);
+/* Records page flip, returns fence that is passed when page is shown */
+unsigned RENDER_showPage(int page);
+/* Records request to present what is drawn before it */
+void RENDER_present(void);
+/* Records pixel (COPY) together with its damage of page, which is reported if pixel is inside clip */
+void RENDER_putPixel(const RASTER_CONTEXT * ctx, int page, int x, int y, unsigned color);
+/* Records damage of page, it is reported after commands before it are drawn */
+void RENDER_damage(int page, int left, int top, int right, int bottom);
+/* Blocks until everything before fence is drawn */
+void RENDER_wait(unsigned fence);
+/* Same as RENDER_wait(RENDER_flush()) */
+void RENDER_finish(void);
+
+#endif
@@ -17,8 +17,10 @@
   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-#include "bgi.h"
+#include "BGI.H"
 #include "IPC.h"
+#include "Atomic.h"
+#include "Render.h"
 #include "graphics.h"
 #include <assert.h>
 #include <stdio.h>
@@ -39,10 +41,17 @@ volatile static struct
 static HWND invisibleWindow;
 static HDC invisibleWindowDC;
 
-static PAGE pages[2];
+static PAGE pages[BGI_MAX_PAGES];
+static int pageCount;
+static int pagesBpp;
+/* 8bpp and 16bpp pages are expanded to it when they are presented */
+static PAGE expandedPage;
 static SHARED_STRUCT * sharedStruct;
 static SHARED_OBJECTS sharedObjects;
 static int exitProcess = FALSE;
+/* MODE_PIPELINE: client primitives are drawn into pages by this thread */
+static RENDER_PLAYER renderPlayer;
+static HANDLE renderThread;
 
 static int systemKey(int key)
 {
@@ -65,24 +74,163 @@ static int systemKey(int key)
   return 0;
 }
 
+/**
+ * Frame clock: presents damage at most once per tick. Without it
+ * (PRESENT_IMMEDIATE) window is still refreshed UPDATES_PER_SECOND
+ * times, in PRESENT_MANUAL mode it is stopped.
+ */
+static void setFrameClock(int mode, int rate)
+{
+  KillTimer(window.wnd, 0);
+  if(mode == PRESENT_COALESCED)
+    SetTimer(window.wnd, 0, 1000 / rate, NULL);
+  else if(mode == PRESENT_IMMEDIATE)
+    SetTimer(window.wnd, 0, 1000 / UPDATES_PER_SECOND, NULL);
+}
+
+/**
+ * Applies all control messages posted by client. Palette changes of
+ * whole batch are merged into one color table update.
+ */
+static void applyControls()
+{
+  BGI_CONTROL message;
+  unsigned completed = 0;
+  int i, first = BGI_PALETTE_SIZE, last = -1;
+  while(BGI_popControl(&sharedStruct->control, &message))
+  {
+    switch(message.type)
+    {
+    case BGI_CONTROL_PALETTE:
+      if(message.first < first)
+        first = message.first;
+      if(message.first + message.count - 1 > last)
+        last = message.first + message.count - 1;
+      break;
+    case BGI_CONTROL_PRESENT:
+      setFrameClock(message.first, message.count);
+      break;
+    }
+    completed = message.sequence;
+  }
+  if(completed == 0)
+    return;
+  if(last >= BGI_PALETTE_SIZE)
+    last = BGI_PALETTE_SIZE - 1;
+  if(last >= first)
+  {
+    for(i = 0; i != pageCount; i++)
+      SetDIBColorTable(pages[i].dc, first, last - first + 1, BGI_palette + first);
+    /* colors of any pixel may be changed */
+    BGI_addDamage(&sharedStruct->damage, sharedStruct->visualPage, 0, 0, window.width, window.height);
+  }
+  ATOMIC_storeRelease(&sharedStruct->control.completed, completed);
+  IPC_raiseEvent(sharedObjects.controlEvent);
+}
+
+/* DC that rectangle of page is copied to window from */
+static HDC presentSource(int page, const BGI_RECT * rect)
+{
+  if(pagesBpp != 8 && pagesBpp != 16)
+    return pages[page].dc;
+  BGI_expandPage(pages + page, pagesBpp, &expandedPage, window.width, window.height, rect);
+  return expandedPage.dc;
+}
+
+/* Copies damaged parts of newest completed frame to window */
+static void presentDamage()
+{
+  BGI_RECT rects[BGI_DAMAGE_RECTS];
+  int i, count, page;
+  BGI_takeFrame(sharedStruct, window.width, window.height);
+  page = sharedStruct->visualPage;
+  count = BGI_takeDamage(&sharedStruct->damage, page, rects, pagesBpp);
+  for(i = 0; i != count; i++)
+  {
+    BitBlt(
+      window.dc, 
+      rects[i].left, 
+      rects[i].top, 
+      rects[i].right - rects[i].left, 
+      rects[i].bottom - rects[i].top, 
+      presentSource(page, rects + i), 
+      rects[i].left, 
+      rects[i].top, 
+      SRCCOPY
+      );
+  }
+}
+
 static void updateWindow()
 {
-  BitBlt(window.dc, 0, 0, window.width, window.height, pages[sharedStruct->visualPage].dc, 0, 0, SRCCOPY);
+  applyControls();
+  presentDamage();
+}
+
+/* System asks to repaint part of window (it is not counted as present) */
+static void paintWindow()
+{
+  PAINTSTRUCT ps;
+  BGI_RECT rect;
+  HDC dc = BeginPaint(window.wnd, &ps);
+  applyControls();
+  rect.left = ps.rcPaint.left;
+  rect.top = ps.rcPaint.top;
+  rect.right = ps.rcPaint.right;
+  rect.bottom = ps.rcPaint.bottom;
+  BitBlt(
+    dc, 
+    ps.rcPaint.left, 
+    ps.rcPaint.top, 
+    ps.rcPaint.right - ps.rcPaint.left, 
+    ps.rcPaint.bottom - ps.rcPaint.top, 
+    presentSource(sharedStruct->visualPage, &rect), 
+    ps.rcPaint.left, 
+    ps.rcPaint.top, 
+    SRCCOPY
+    );
+  EndPaint(window.wnd, &ps);
 }
 
 static LRESULT WINAPI InvisibleWindowProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
+  BGI_RECT all;
   switch(msg)
   {
   case WM_PAINT:
   case WM_TIMER:
-    BitBlt(invisibleWindowDC, 0, 0, window.width, window.height, pages[1 - sharedStruct->visualPage].dc, 0, 0, SRCCOPY);
+    all.left = all.top = 0;
+    all.right = window.width;
+    all.bottom = window.height;
+    /* page after visual one, that is the one being drawn when there are two */
+    BitBlt(invisibleWindowDC, 0, 0, window.width, window.height, presentSource((sharedStruct->visualPage + 1) % pageCount, &all), 0, 0, SRCCOPY);
     break;
   }
   return DefWindowProc(hWnd, msg, wParam, lParam);
 }
 
 
+/* Queues input event for client. Client waiting for key is woken up */
+static void postEvent(int type, int key, int letter)
+{
+  BGI_EVENT event;
+  event.type = type;
+  event.time = (unsigned)GetMessageTime();
+  event.key = key;
+  event.letter = letter;
+  event.x = sharedStruct->mouseX;
+  event.y = sharedStruct->mouseY;
+  event.buttons = sharedStruct->mouseButton;
+  if(BGI_pushEvent(&sharedStruct->events, &event) && type == BGI_EVENT_KEY)
+    IPC_raiseEvent(sharedObjects.keyboardEvent);
+}
+
+static void updateMouse(LPARAM lParam)
+{
+  sharedStruct->mouseX = (int)(lParam & 0xFFFF);
+  sharedStruct->mouseY = (int)(lParam >> 16);
+}
+
 static LRESULT WINAPI MainWindowProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
   static int keyProcessed = 0;
@@ -97,53 +245,52 @@ static LRESULT WINAPI MainWindowProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM
         SetFocus(invisibleWindow);
     }
     break;
-  case WM_MYPALETTECHANGED:
-    SetDIBColorTable(pages[0].dc, (UINT)wParam, (UINT)lParam, BGI_palette + wParam);
-    SetDIBColorTable(pages[1].dc, (UINT)wParam, (UINT)lParam, BGI_palette + wParam);
+  case WM_CONTROL:
+    /* cleared before messages are taken, so newer ones cause new WM_CONTROL */
+    ATOMIC_exchange(&sharedStruct->control.wakePending, 0);
+    applyControls();
+    if(sharedStruct->presentMode == PRESENT_IMMEDIATE)
+      presentDamage();
+    break;
+  case WM_PRESENT:
     updateWindow();
     break;
   case WM_LBUTTONDOWN:
+    updateMouse(lParam);
     sharedStruct->mouseButton |= MOUSE_LEFTBUTTON;
+    postEvent(BGI_EVENT_MOUSEDOWN, 0, 0);
     break;
   case WM_RBUTTONDOWN:
+    updateMouse(lParam);
     sharedStruct->mouseButton |= MOUSE_RIGHTBUTTON;
+    postEvent(BGI_EVENT_MOUSEDOWN, 0, 0);
     break;
   case WM_LBUTTONUP:
+    updateMouse(lParam);
     sharedStruct->mouseButton &= ~MOUSE_LEFTBUTTON;
+    postEvent(BGI_EVENT_MOUSEUP, 0, 0);
     break;
   case WM_RBUTTONUP:
+    updateMouse(lParam);
     sharedStruct->mouseButton &= ~MOUSE_RIGHTBUTTON;
+    postEvent(BGI_EVENT_MOUSEUP, 0, 0);
     break;
   case WM_MOUSEMOVE:
-    sharedStruct->mouseX = (int)(lParam & 0xFFFF);
-    sharedStruct->mouseY = (int)(lParam >> 16);
+    updateMouse(lParam);
+    postEvent(BGI_EVENT_MOUSEMOVE, 0, 0);
     break;
-  case WM_KEYPROCESSED:
-    sharedStruct->keyCode = -1;
-    return 0;
   case WM_DESTROY:
     PostQuitMessage(0);
     break;
   case WM_KEYDOWN:
-    Sleep(1);
-    if(sharedStruct->keyCode == -1)
+    if(systemKey((int)wParam))
     {
-      if(systemKey((int)wParam))
-      {
-        if(
-          wParam != VK_LSHIFT && wParam != VK_RSHIFT &&
-          wParam != VK_RCONTROL && wParam != VK_LCONTROL
-          )
-        {
-          sharedStruct->keyCode = (int)wParam;
-          keyProcessed = 1;
-          IPC_raiseEvent(sharedObjects.keyboardEvent);
-        }
-      } 
-      else 
-      {
-          keyProcessed = 0;
-      }
+      postEvent(BGI_EVENT_KEY, (int)wParam, 0);
+      keyProcessed = 1;
+    } 
+    else 
+    {
+      keyProcessed = 0;
     }
     break;
   case WM_CHAR:
@@ -154,9 +301,7 @@ static LRESULT WINAPI MainWindowProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM
       }
       else
       {
-        sharedStruct->keyLetter = (int)wParam;
-        sharedStruct->keyCode = 0;
-        IPC_raiseEvent(sharedObjects.keyboardEvent);
+        postEvent(BGI_EVENT_KEY, 0, (int)wParam);
       }
     }
     break;
@@ -164,13 +309,15 @@ static LRESULT WINAPI MainWindowProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM
     PostQuitMessage(0);
     exitProcess = TRUE;
     break;
-  case WM_KEYUP:
-    sharedStruct->keyCode = -1;
-    break;
   case WM_TIMER:
-  case WM_PAINT:
-    updateWindow();
+    /* tick of frame clock, nothing is copied if nothing was drawn */
+    applyControls();
+    if(sharedStruct->presentMode != PRESENT_MANUAL)
+      presentDamage();
     break;
+  case WM_PAINT:
+    paintWindow();
+    return 0;
   }
   return DefWindowProc(hWnd, msg, wParam, lParam);
 }
@@ -194,22 +341,75 @@ void registerClass(const char * className, WNDPROC wndProc)
   RegisterClassEx(&wcx);
 }
 
+/* Render thread completed frame. It is taken by window thread when it presents */
+static void showRenderedPage(int page)
+{
+  BGI_publishFrame(sharedStruct, page);
+}
+
+static void addRenderedDamage(int page, int left, int top, int right, int bottom)
+{
+  BGI_addDamage(&sharedStruct->damage, page, left, top, right, bottom);
+}
+
+static void presentRenderedPage(int explicitly)
+{
+  if(explicitly)
+    PostMessage(window.wnd, WM_PRESENT, 0, 0);
+  /* WM_CONTROL handler presents damage, one message serves many presents */
+  else if(sharedStruct->presentMode == PRESENT_IMMEDIATE && ATOMIC_exchange(&sharedStruct->control.wakePending, 1) == 0)
+    PostMessage(window.wnd, WM_CONTROL, 0, 0);
+}
+
+static void renderThreadProc(void * player)
+{
+  RENDER_play(player);
+}
+
+static void startRenderThread(void)
+{
+  int i;
+  renderPlayer.queue = sharedObjects.renderQueue;
+  renderPlayer.commandEvent = sharedObjects.renderCommandEvent;
+  renderPlayer.doneEvent = sharedObjects.renderDoneEvent;
+  for(i = 0; i != pageCount; i++)
+    RASTER_initSurface(renderPlayer.surfaces + i, pages[i].bits, window.width, window.height, pagesBpp);
+  /* glyph cache is per process, client built its own one in initgraph */
+  RASTER_initFont();
+  renderPlayer.showPage = showRenderedPage;
+  renderPlayer.damage = addRenderedDamage;
+  renderPlayer.present = presentRenderedPage;
+  renderThread = IPC_startThread(renderThreadProc, &renderPlayer);
+}
+
 /* Creates all server-side shared objects (mutexes, pages, events etc) */
-void createSharedObjects(int rgb)
+void createSharedObjects(int bpp, int pipeline)
 {
   int i;
+  pagesBpp = bpp;
   sharedObjects.serverCreatedEvent = IPC_openEvent(SERVER_STARTED_EVENT_NAME);
   sharedObjects.keyboardEvent = IPC_createEvent(KEYBOARD_MUTEX_NAME);
+  sharedObjects.controlEvent = IPC_createEvent(CONTROL_EVENT_NAME);
   sharedObjects.clientPresentMutex = IPC_openMutex(CLIENT_PRESENT_MUTEX_NAME);
   sharedObjects.serverPresentMutex = IPC_createMutex(SERVER_PRESENT_MUTEX_NAME, TRUE);
-  sharedStruct = IPC_createSharedMemory(SHARED_STRUCT_NAME, sizeof(SHARED_STRUCT_NAME));
-  BGI_palette = IPC_createSharedMemory(PALETTE_SECTION_NAME, sizeof(RGBQUAD)*16);
+  sharedStruct = IPC_createSharedMemory(SHARED_STRUCT_NAME, sizeof(SHARED_STRUCT));
+  sharedStruct->pagesBpp = bpp;
+  BGI_palette = IPC_createSharedMemory(PALETTE_SECTION_NAME, sizeof(RGBQUAD) * BGI_PALETTE_SIZE);
   BGI_initPalette();
-  sharedStruct->keyCode = -1;
-  for(i = 0; i != 2; i++)
+  for(i = 0; i != pageCount; i++)
   {
     sharedObjects.pagesSection[i] = IPC_createSection(PAGES_SECTION_NAME[i], window.width * window.height * 4);
-    BGI_createPage(pages+ i, window.dc, sharedObjects.pagesSection[i], window.width, window.height, rgb);
+    BGI_createPage(pages+ i, window.dc, sharedObjects.pagesSection[i], window.width, window.height, bpp);
+  }
+  if(bpp == 8 || bpp == 16)
+    BGI_createPage(&expandedPage, window.dc, NULL, window.width, window.height, 32);
+  sharedObjects.renderQueue = NULL;
+  if(pipeline)
+  {
+    sharedObjects.renderCommandEvent = IPC_createEvent(RENDER_COMMAND_EVENT_NAME);
+    sharedObjects.renderDoneEvent = IPC_createEvent(RENDER_DONE_EVENT_NAME);
+    /* new section is zero filled, so queue is empty */
+    sharedObjects.renderQueue = IPC_createSharedMemory(RENDER_QUEUE_SECTION_NAME, sizeof(RENDER_QUEUE));
   }
 }
 
@@ -254,9 +454,10 @@ HWND createWindow(LPCSTR className, LPCSTR title)
 
 void BGI_server(DWORD param)
 {
-  int options = (param >> 24) & 0xFFF;
+  int options = MODE_FROM_SERVER((param >> 24) & 0xFF);
   window.width = param & 0xFFF;
   window.height = (param >> 12) & 0xFFF;
+  pageCount = MODE_PAGE_COUNT(options);
   
   registerClass(WINDOW_CLASS_NAME, &MainWindowProc);
   registerClass(INVISIBLE_WINDOW_CLASS_NAME, &InvisibleWindowProc);
@@ -280,8 +481,11 @@ void BGI_server(DWORD param)
   
   window.dc = GetDC(window.wnd);
 
-  createSharedObjects(options & MODE_RGB);
-  SetTimer(window.wnd, 0, 1000 / UPDATES_PER_SECOND, NULL);
+  createSharedObjects(MODE_BPP(options), options & MODE_PIPELINE);
+  renderThread = NULL;
+  if(options & MODE_PIPELINE)
+    startRenderThread();
+  setFrameClock(PRESENT_IMMEDIATE, 0);
   if((options & MODE_RELEASE) == 0)
   {
     exitProcess = TRUE;
@@ -289,6 +493,9 @@ void BGI_server(DWORD param)
   }
   IPC_raiseEvent(sharedObjects.serverCreatedEvent);
   windowLoop();
+  /* client stops recording before it closes window, so thread has returned */
+  if(renderThread != NULL && !exitProcess)
+    IPC_joinThread(renderThread);
   BGI_closeSharedObjects(&sharedObjects, sharedStruct);
   if(exitProcess) 
     ExitProcess(0);
@@ -0,0 +1,459 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Span.h"
+#include <string.h>
+
+/* SIMD kernels are compiled for x86 only, GCC needs target attributes for them */
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+  #define SPAN_X86
+  #define SPAN_TARGET(NAME) __attribute__((target(NAME)))
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  #define SPAN_X86
+  #define SPAN_TARGET(NAME)
+  #include <intrin.h>
+#endif
+
+#ifdef SPAN_X86
+  #include <immintrin.h>
+#endif
+
+typedef void (*SPAN_FILL_PROC)(unsigned char * dst, size_t count, const unsigned char * pattern, unsigned phase);
+typedef void (*SPAN_BLIT_PROC)(unsigned char * dst, const unsigned char * src, size_t count, int op, unsigned invert);
+typedef void (*SPAN_EXPAND_PROC)(unsigned * dst, const unsigned char * src, size_t count, const unsigned * table);
+typedef void (*SPAN_EXPAND565_PROC)(unsigned * dst, const unsigned short * src, size_t count);
+
+static SPAN_FILL_PROC fillProc = NULL;
+static SPAN_BLIT_PROC blitProc = NULL;
+static SPAN_EXPAND_PROC expandProc = NULL;
+static SPAN_EXPAND565_PROC expand565Proc = NULL;
+static int selected = SPAN_C;
+
+static void fillC(unsigned char * dst, size_t count, const unsigned char * pattern, unsigned phase)
+{
+  /* copy of whole period keeps phase */
+  pattern += phase % SPAN_PERIOD;
+  for(; count >= SPAN_PERIOD; count -= SPAN_PERIOD, dst += SPAN_PERIOD)
+    memcpy(dst, pattern, SPAN_PERIOD);
+  memcpy(dst, pattern, count);
+}
+
+/* Blits by 32-bit words, then byte by byte, byte i of src is XORed with byte i % 4 of invert */
+static void blitC(unsigned char * dst, const unsigned char * src, size_t count, int op, unsigned invert)
+{
+  unsigned char bytes[4];
+  unsigned s, d;
+  size_t i;
+  for(i = 0; i + 4 <= count; i += 4)
+  {
+    /* memcpy does unaligned access, compilers make it plain load or store */
+    memcpy(&s, src + i, 4);
+    memcpy(&d, dst + i, 4);
+    s ^= invert;
+    switch(op)
+    {
+    case SPAN_XOR:
+      d ^= s;
+      break;
+    case SPAN_OR:
+      d |= s;
+      break;
+    case SPAN_AND:
+      d &= s;
+      break;
+    default:
+      d = s;
+    }
+    memcpy(dst + i, &d, 4);
+  }
+  memcpy(bytes, &invert, 4);
+  for(; i != count; i++)
+  {
+    s = src[i] ^ bytes[i & 3];
+    switch(op)
+    {
+    case SPAN_XOR:
+      dst[i] ^= (unsigned char)s;
+      break;
+    case SPAN_OR:
+      dst[i] |= (unsigned char)s;
+      break;
+    case SPAN_AND:
+      dst[i] &= (unsigned char)s;
+      break;
+    default:
+      dst[i] = (unsigned char)s;
+    }
+  }
+}
+
+static void expandC(unsigned * dst, const unsigned char * src, size_t count, const unsigned * table)
+{
+  size_t i;
+  for(i = 0; i + 4 <= count; i += 4)
+  {
+    dst[i] = table[src[i]];
+    dst[i + 1] = table[src[i + 1]];
+    dst[i + 2] = table[src[i + 2]];
+    dst[i + 3] = table[src[i + 3]];
+  }
+  for(; i != count; i++)
+    dst[i] = table[src[i]];
+}
+
+/* Top bits of 5 and 6 bit components are repeated in low ones, so 0x1F becomes 0xFF */
+static void expand565C(unsigned * dst, const unsigned short * src, size_t count)
+{
+  size_t i;
+  unsigned p, r, g, b;
+  for(i = 0; i != count; i++)
+  {
+    p = src[i];
+    r = p >> 11;
+    g = (p >> 5) & 0x3F;
+    b = p & 0x1F;
+    dst[i] = ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+  }
+}
+
+#ifdef SPAN_X86
+
+/**
+ * SIMD kernels write unaligned head and tail by unaligned stores that
+ * overlap aligned ones, pattern is the same there, so spans shorter
+ * than two stores are left to fillC.
+ */
+
+SPAN_TARGET("sse2")
+static void fillSSE2(unsigned char * dst, size_t count, const unsigned char * pattern, unsigned phase)
+{
+  size_t head;
+  __m128i a, b;
+  if(count < 32)
+  {
+    fillC(dst, count, pattern, phase);
+    return;
+  }
+  phase %= SPAN_PERIOD;
+  _mm_storeu_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)(pattern + phase)));
+  head = (0 - (size_t)dst) & 15;
+  dst += head;
+  count -= head;
+  phase = (phase + (unsigned)head) % SPAN_PERIOD;
+  a = _mm_loadu_si128((const __m128i *)(pattern + phase));
+  b = _mm_loadu_si128((const __m128i *)(pattern + phase + 16));
+  for(; count >= 32; count -= 32, dst += 32)
+  {
+    _mm_store_si128((__m128i *)dst, a);
+    _mm_store_si128((__m128i *)(dst + 16), b);
+  }
+  if(count > 16)
+    _mm_store_si128((__m128i *)dst, a);
+  /* last 16 bytes, bytes before dst are already filled */
+  if(count != 0)
+    _mm_storeu_si128(
+      (__m128i *)(dst + count - 16),
+      _mm_loadu_si128((const __m128i *)(pattern + (phase + count + 16) % SPAN_PERIOD))
+      );
+}
+
+SPAN_TARGET("avx2")
+static void fillAVX2(unsigned char * dst, size_t count, const unsigned char * pattern, unsigned phase)
+{
+  size_t head;
+  __m256i a;
+  if(count < 64)
+  {
+    fillSSE2(dst, count, pattern, phase);
+    return;
+  }
+  phase %= SPAN_PERIOD;
+  _mm256_storeu_si256((__m256i *)dst, _mm256_loadu_si256((const __m256i *)(pattern + phase)));
+  head = (0 - (size_t)dst) & 31;
+  dst += head;
+  count -= head;
+  phase = (phase + (unsigned)head) % SPAN_PERIOD;
+  a = _mm256_loadu_si256((const __m256i *)(pattern + phase));
+  for(; count >= 128; count -= 128, dst += 128)
+  {
+    _mm256_store_si256((__m256i *)dst, a);
+    _mm256_store_si256((__m256i *)(dst + 32), a);
+    _mm256_store_si256((__m256i *)(dst + 64), a);
+    _mm256_store_si256((__m256i *)(dst + 96), a);
+  }
+  for(; count >= 32; count -= 32, dst += 32)
+    _mm256_store_si256((__m256i *)dst, a);
+  /* last 32 bytes, bytes before dst are already filled */
+  if(count != 0)
+    _mm256_storeu_si256(
+      (__m256i *)(dst + count - 32),
+      _mm256_loadu_si256((const __m256i *)(pattern + (phase + count) % SPAN_PERIOD))
+      );
+}
+
+/**
+ * Blit kernels process whole vectors by unaligned loads and stores and
+ * leave the rest to blitC. Vectors are multiples of 4 bytes, so words
+ * of invert stay aligned with words of src.
+ */
+#define BLIT_LOOP(TYPE, SIZE, LOAD, STORE, XOR, EXPR) \
+  for(; i + SIZE <= count; i += SIZE) \
+  { \
+    s = XOR(LOAD((const TYPE *)(src + i)), mask); \
+    d = LOAD((const TYPE *)(dst + i)); \
+    STORE((TYPE *)(dst + i), EXPR); \
+  }
+
+SPAN_TARGET("sse2")
+static void blitSSE2(unsigned char * dst, const unsigned char * src, size_t count, int op, unsigned invert)
+{
+  size_t i = 0;
+  __m128i mask = _mm_set1_epi32((int)invert), s, d;
+  switch(op)
+  {
+  case SPAN_XOR:
+    BLIT_LOOP(__m128i, 16, _mm_loadu_si128, _mm_storeu_si128, _mm_xor_si128, _mm_xor_si128(d, s))
+    break;
+  case SPAN_OR:
+    BLIT_LOOP(__m128i, 16, _mm_loadu_si128, _mm_storeu_si128, _mm_xor_si128, _mm_or_si128(d, s))
+    break;
+  case SPAN_AND:
+    BLIT_LOOP(__m128i, 16, _mm_loadu_si128, _mm_storeu_si128, _mm_xor_si128, _mm_and_si128(d, s))
+    break;
+  default:
+    BLIT_LOOP(__m128i, 16, _mm_loadu_si128, _mm_storeu_si128, _mm_xor_si128, s)
+  }
+  blitC(dst + i, src + i, count - i, op, invert);
+}
+
+SPAN_TARGET("avx2")
+static void blitAVX2(unsigned char * dst, const unsigned char * src, size_t count, int op, unsigned invert)
+{
+  size_t i = 0;
+  __m256i mask = _mm256_set1_epi32((int)invert), s, d;
+  switch(op)
+  {
+  case SPAN_XOR:
+    BLIT_LOOP(__m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_xor_si256, _mm256_xor_si256(d, s))
+    break;
+  case SPAN_OR:
+    BLIT_LOOP(__m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_xor_si256, _mm256_or_si256(d, s))
+    break;
+  case SPAN_AND:
+    BLIT_LOOP(__m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_xor_si256, _mm256_and_si256(d, s))
+    break;
+  default:
+    BLIT_LOOP(__m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_xor_si256, s)
+  }
+  /* SSE2 code is slow while upper halves of registers are dirty */
+  _mm256_zeroupper();
+  blitSSE2(dst + i, src + i, count - i, op, invert);
+}
+
+/* SSE2 has no gather: four lookups are stored as one vector */
+SPAN_TARGET("sse2")
+static void expandSSE2(unsigned * dst, const unsigned char * src, size_t count, const unsigned * table)
+{
+  size_t i;
+  for(i = 0; i + 4 <= count; i += 4)
+    _mm_storeu_si128(
+      (__m128i *)(dst + i),
+      _mm_set_epi32((int)table[src[i + 3]], (int)table[src[i + 2]], (int)table[src[i + 1]], (int)table[src[i]])
+      );
+  expandC(dst + i, src + i, count - i, table);
+}
+
+/* Eight indexes are widened to 32 bits and gathered from table at once */
+SPAN_TARGET("avx2")
+static void expandAVX2(unsigned * dst, const unsigned char * src, size_t count, const unsigned * table)
+{
+  size_t i;
+  __m256i index;
+  for(i = 0; i + 8 <= count; i += 8)
+  {
+    index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_i32gather_epi32((const int *)table, index, 4));
+  }
+  _mm256_zeroupper();
+  expandC(dst + i, src + i, count - i, table);
+}
+
+/**
+ * 565 pixels are widened in 16-bit lanes: blue and green are merged
+ * into low words of 32bpp pixels and red into high ones by unpacking
+ */
+#define EXPAND565(TYPE, P, SRLI, SLLI, AND, OR, SET1, UNPACKLO, UNPACKHI, LO, HI) \
+  { \
+    TYPE r, g, b; \
+    r = SRLI(P, 11); \
+    g = AND(SRLI(P, 5), SET1(0x3F)); \
+    b = AND(P, SET1(0x1F)); \
+    r = OR(SLLI(r, 3), SRLI(r, 2)); \
+    g = OR(SLLI(g, 2), SRLI(g, 4)); \
+    b = OR(SLLI(b, 3), SRLI(b, 2)); \
+    b = OR(b, SLLI(g, 8)); \
+    LO = UNPACKLO(b, r); \
+    HI = UNPACKHI(b, r); \
+  }
+
+SPAN_TARGET("sse2")
+static void expand565SSE2(unsigned * dst, const unsigned short * src, size_t count)
+{
+  size_t i;
+  __m128i p, lo, hi;
+  for(i = 0; i + 8 <= count; i += 8)
+  {
+    p = _mm_loadu_si128((const __m128i *)(src + i));
+    EXPAND565(__m128i, p, _mm_srli_epi16, _mm_slli_epi16, _mm_and_si128, _mm_or_si128, _mm_set1_epi16,
+      _mm_unpacklo_epi16, _mm_unpackhi_epi16, lo, hi)
+    _mm_storeu_si128((__m128i *)(dst + i), lo);
+    _mm_storeu_si128((__m128i *)(dst + i + 4), hi);
+  }
+  expand565C(dst + i, src + i, count - i);
+}
+
+/* Unpacking works within 128-bit halves, so halves of results are swapped back to order of pixels */
+SPAN_TARGET("avx2")
+static void expand565AVX2(unsigned * dst, const unsigned short * src, size_t count)
+{
+  size_t i;
+  __m256i p, lo, hi;
+  for(i = 0; i + 16 <= count; i += 16)
+  {
+    p = _mm256_loadu_si256((const __m256i *)(src + i));
+    EXPAND565(__m256i, p, _mm256_srli_epi16, _mm256_slli_epi16, _mm256_and_si256, _mm256_or_si256, _mm256_set1_epi16,
+      _mm256_unpacklo_epi16, _mm256_unpackhi_epi16, lo, hi)
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  _mm256_zeroupper();
+  expand565SSE2(dst + i, src + i, count - i);
+}
+
+static int supported(int kernel)
+{
+#if defined(__GNUC__)
+  __builtin_cpu_init();
+  if(kernel == SPAN_AVX2)
+    return __builtin_cpu_supports("avx2");
+  return __builtin_cpu_supports("sse2");
+#else
+  int info[4];
+  if(kernel == SPAN_SSE2)
+  {
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+  }
+  __cpuid(info, 0);
+  if(info[0] < 7)
+    return 0;
+  __cpuid(info, 1);
+  /* OS must save YMM registers */
+  if(!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6)
+    return 0;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+#endif
+
+int SPAN_setKernel(int newKernel)
+{
+  switch(newKernel)
+  {
+  case SPAN_C:
+    fillProc = fillC;
+    blitProc = blitC;
+    expandProc = expandC;
+    expand565Proc = expand565C;
+    break;
+#ifdef SPAN_X86
+  case SPAN_SSE2:
+    if(!supported(SPAN_SSE2))
+      return 0;
+    fillProc = fillSSE2;
+    blitProc = blitSSE2;
+    expandProc = expandSSE2;
+    expand565Proc = expand565SSE2;
+    break;
+  case SPAN_AVX2:
+    if(!supported(SPAN_AVX2))
+      return 0;
+    fillProc = fillAVX2;
+    blitProc = blitAVX2;
+    expandProc = expandAVX2;
+    expand565Proc = expand565AVX2;
+    break;
+#endif
+  default:
+    return 0;
+  }
+  selected = newKernel;
+  return 1;
+}
+
+/* Selects best kernel supported by CPU */
+static void selectKernel(void)
+{
+  if(!SPAN_setKernel(SPAN_AVX2) && !SPAN_setKernel(SPAN_SSE2))
+    SPAN_setKernel(SPAN_C);
+}
+
+int SPAN_kernel(void)
+{
+  if(fillProc == NULL)
+    selectKernel();
+  return selected;
+}
+
+void SPAN_fill(unsigned char * dst, size_t count, const unsigned char * pattern, unsigned phase)
+{
+  /* every thread selects the same kernel, so race is harmless */
+  if(fillProc == NULL)
+    selectKernel();
+  fillProc(dst, count, pattern, phase);
+}
+
+void SPAN_blit(unsigned char * dst, const unsigned char * src, size_t count, int op, unsigned invert)
+{
+  /* library copy is as fast as it gets */
+  if(op == SPAN_COPY && invert == 0)
+  {
+    memcpy(dst, src, count);
+    return;
+  }
+  if(blitProc == NULL)
+    selectKernel();
+  blitProc(dst, src, count, op, invert);
+}
+
+void SPAN_expand(unsigned * dst, const unsigned char * src, size_t count, const unsigned * table)
+{
+  if(expandProc == NULL)
+    selectKernel();
+  expandProc(dst, src, count, table);
+}
+
+void SPAN_expand565(unsigned * dst, const unsigned short * src, size_t count)
+{
+  if(expand565Proc == NULL)
+    selectKernel();
+  expand565Proc(dst, src, count);
+}
@@ -0,0 +1,73 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __SPAN_H__
+#define __SPAN_H__
+
+#include <stddef.h>
+
+/**
+ * Span filling kernels used by rasterizer for bars and clears. Row of
+ * any fill is a 32-byte pattern repeated (8 pixels of 32bpp surface or
+ * 64 pixels of 4bpp one, both are multiples of 8x8 fill pattern width),
+ * so one kernel fills rows of both formats. Kernel is selected at first
+ * use by what CPU supports: AVX2, SSE2 or plain C.
+ *
+ * Blit kernels combine rows of images with rows of surface by bitwise
+ * operations, they are selected together with fill kernels, as well as
+ * expand kernels that turn indexed pixels into 32bpp ones by palette
+ * and 16bpp RGB565 pixels into 32bpp ones when they are presented.
+ */
+
+/* Bytes in period of span pattern */
+#define SPAN_PERIOD 32
+
+/* Operations of blits */
+#define SPAN_COPY 0
+#define SPAN_XOR  1
+#define SPAN_OR   2
+#define SPAN_AND  3
+
+/* Kernels */
+#define SPAN_C    0
+#define SPAN_SSE2 1
+#define SPAN_AVX2 2
+
+/**
+ * Fills count bytes from dst with pattern. Pattern is 2 * SPAN_PERIOD
+ * bytes: period stored twice, so it may be read from any phase. dst[0]
+ * gets pattern[phase % SPAN_PERIOD].
+ */
+void SPAN_fill(unsigned char * dst, size_t count, const unsigned char * pattern, unsigned phase);
+/**
+ * Combines count bytes of dst with src by op. Every 32-bit word of src
+ * (counted from src[0]) is XORed with invert first, so NOT of image is
+ * SPAN_COPY with invert of all pixel bits.
+ */
+void SPAN_blit(unsigned char * dst, const unsigned char * src, size_t count, int op, unsigned invert);
+/* Expands count 8-bit indexes of src to 32-bit values of table (256 of them) */
+void SPAN_expand(unsigned * dst, const unsigned char * src, size_t count, const unsigned * table);
+/* Expands count RGB565 pixels of src to 32bpp ones */
+void SPAN_expand565(unsigned * dst, const unsigned short * src, size_t count);
+/* Selects kernel, returns 0 if it is not supported by CPU */
+int SPAN_setKernel(int kernel);
+/* Returns selected kernel */
+int SPAN_kernel(void);
+
+#endif
@@ -17,24 +17,22 @@
   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-#ifndef _MSC_VER
-  #define _WIN_VER 0x500
-#endif
-
-#include <Windows.h>
-
-#include "BGI.h"
+#include "BGI.H"
+#include "Raster.h"
+#include "Render.h"
+#include "Capture.h"
+#include "Font.h"
+#include "Atomic.h"
 #include "graphics.h"
 
 #define _USE_MATH_DEFINES
 
-#include <math.h>
 #include <time.h>
 #include <string.h>
+#include <stdlib.h>
 #include <assert.h>
-
-#ifndef M_PI
-#define M_PI       3.14159265358979323846
+#ifndef _WIN32
+  #include <unistd.h>
 #endif
 
 enum WhatChanged
@@ -45,8 +43,8 @@ enum WhatChanged
   CHANGED_ALL = 0xF
 };
 
-#define DEG_TO_RAD(X)  ((X) * M_PI / 180.0)
 typedef void (*putpixelProc_t)(int x, int y, int color);
+typedef unsigned (*getpixelProc_t)(int x, int y);
 
 static g_pointtype modeResolution[] = {{640,200}, {640,350}, {640,480}, {640,480}, {800,600},{1024,768}};
 
@@ -55,18 +53,39 @@ static int frameCounter = 0;
 static int FPS = 0;
 static int XORMode = 0;
 
-static HDC windowDC;
 static int windowWidth;
 static int windowHeight;
 static int length;
 static PAGE * pages;
+static int pageCount = 2;
 static int activePageIndex = 0;
 static unsigned char * activeBits;
 static HDC activeDC;
 static SHARED_STRUCT * sharedStruct;
 
+/* Headless mode has no window and no server, there are no DCs */
+static int headless = 0;
+/* Primitives are drawn by software rasterizer instead of GDI (headless and pipeline modes) */
+static int software = 0;
+/* Pipeline mode records primitives, they are drawn by render thread */
+static int pipeline = 0;
+static const RENDER_TARGET * target = &RENDER_direct;
+/* Passed when last page given to setvisualpage is shown */
+static unsigned frameFence;
+/* Last page given to setvisualpage */
+static int publishedPage;
+/* Pipeline mode: shown page that is captured when render thread has drawn it, or -1 */
+static int capturePending = -1;
+static RASTER_CONTEXT raster;
+/* Temporary memory of primitives that are drawn by this thread */
+static RASTER_SCRATCH scratch;
+/* Tables of row pointers of pages given by lockpage, made at first lock */
+static unsigned char ** pageRows[BGI_MAX_PAGES];
+
+#ifdef _WIN32
 static HBRUSH stdBrushes[USER_FILL + 1];
 static HPEN stdPens[USERBIT_LINE];
+#endif
 
 static struct 
 {
@@ -75,11 +94,14 @@ static struct
 } aspectRatio = {1, 1};
 
 static int graphMode = -1;
+static int graphError = grOk;
 static int rgbMode = 0;
+/* Bits per pixel of pages: 4, 8 (256 colors), 16 (HICOLOR) or 32 (RGB) */
+static int pageBpp = 4;
 
-static COLORREF builtinPalette[MAXCOLORS];
-static HBRUSH backBrush;
-static HBRUSH currentBrush;
+#ifdef _WIN32
+static COLORREF builtinPalette[BGI_PALETTE_SIZE];
+#endif
 static g_pointtype currentPosition;
 static int backColor = _BLACK;
 static int penColor = _WHITE;
@@ -112,18 +134,33 @@ static unsigned short patternsBits[USER_FILL + 1][8] =
   {221, 119, 221, 119, 221, 119, 221, 119},
 };
 
+/* Converts color to value of page pixel */
+static unsigned pixelColor(int color)
+{
+  if(rgbMode)
+    return pageBpp == 16 ? (unsigned)color & 0xFFFF : (unsigned)color;
+  return (unsigned)(color & (pageBpp == 8 ? 0xFF : 0xF));
+}
+
+#ifdef _WIN32
+
 static COLORREF translateColor(int color)
 {
+  if(rgbMode && pageBpp == 16)
+    return (COLORREF)RGB((color >> 8) & 0xF8, (color >> 3) & 0xFC, (color << 3) & 0xF8);
   if(rgbMode)
     return (COLORREF)RGB(color >> 16, (color >> 8) & 0xFF, color & 0xFF);
+  if(pageBpp == 8)
+    return builtinPalette[color & 0xFF];
   return builtinPalette[palette.colors[color % MAXCOLORS]];
 }
 
 static void selectObject(HANDLE object, int del)
 {
+  int pc;
   HANDLE oldObject = SelectObject(pages[0].dc, object);
-  SelectObject(pages[1].dc, object);
-  SelectObject(windowDC, object);
+  for(pc = 1; pc != pageCount; pc++)
+    SelectObject(pages[pc].dc, object);
   if(del)
     DeleteObject(oldObject);
 }
@@ -139,78 +176,325 @@ static void initBrushes()
   }
 }
 
-static void endDraw()
+#endif
+
+/* Marks part of page as changed, coordinates are page ones, right and bottom exclusive */
+static void reportPageDamage(int page, int left, int top, int right, int bottom)
 {
-  if(activePageIndex == sharedStruct->visualPage)
+  /* in pipeline mode damage is reported when render thread has drawn primitive */
+  if(pipeline)
+    RENDER_damage(page, left, top, right, bottom);
+  else
+    BGI_addDamage(&sharedStruct->damage, page, left, top, right, bottom);
+}
+
+static void reportDamage(int left, int top, int right, int bottom)
+{
+  reportPageDamage(activePageIndex, left, top, right, bottom);
+}
+
+/**
+ * Reports bounding box of primitive that was just drawn. Corners are
+ * inclusive, in viewport coordinates, in any order. Box is grown by
+ * half of line thickness and clipped.
+ */
+static void damage(int x1, int y1, int x2, int y2)
+{
+  int left = x1 < x2 ? x1 : x2, right = x1 < x2 ? x2 : x1;
+  int top = y1 < y2 ? y1 : y2, bottom = y1 < y2 ? y2 : y1;
+  int margin = lineSettings.thickness / 2;
+  /* GDI moves origin only for clipping viewport */
+  if(software || viewPort.clip)
   {
-    BGI_updateWindow();
+    left += viewPort.left;
+    right += viewPort.left;
+    top += viewPort.top;
+    bottom += viewPort.top;
   }
+  left -= margin;
+  top -= margin;
+  right += margin;
+  bottom += margin;
+  if(left < raster.clipLeft)
+    left = raster.clipLeft;
+  if(top < raster.clipTop)
+    top = raster.clipTop;
+  if(right > raster.clipRight)
+    right = raster.clipRight;
+  if(bottom > raster.clipBottom)
+    bottom = raster.clipBottom;
+  if(left <= right && top <= bottom)
+    reportDamage(left, top, right + 1, bottom + 1);
 }
 
-#define CHECK_COLOR_RANGE(COLOR) if(!rgbMode && (COLOR < 0 || COLOR >= MAXCOLORS)) return;
-#define CHECK_GRAPHCS_INITED if(graphMode == -1) return;
-#define ICHECK_GRAPHCS_INITED if(graphMode == -1) return -1;
+/* Primitive may have changed anything inside clip rectangle */
+static void damageClip()
+{
+  reportDamage(raster.clipLeft, raster.clipTop, raster.clipRight + 1, raster.clipBottom + 1);
+}
 
-#define BEGIN_DRAW  CHECK_GRAPHCS_INITED
-#define END_DRAW   endDraw();
+static void damagePoints(int numpoints, const int * points)
+{
+  int i, left, top, right, bottom;
+  if(numpoints <= 0)
+    return;
+  left = right = points[0];
+  top = bottom = points[1];
+  for(i = 1; i < numpoints; i++)
+  {
+    if(points[i * 2] < left)
+      left = points[i * 2];
+    if(points[i * 2] > right)
+      right = points[i * 2];
+    if(points[i * 2 + 1] < top)
+      top = points[i * 2 + 1];
+    if(points[i * 2 + 1] > bottom)
+      bottom = points[i * 2 + 1];
+  }
+  damage(left, top, right, bottom);
+}
 
-#define BEGIN_FILL { COLORREF c = translateColor(fillSettings.color); BEGIN_DRAW SetTextColor(activeDC, c);}
-#define END_FILL { COLORREF c = penColor; BEGIN_DRAW SetTextColor(activeDC, c); END_DRAW  }
+/* Bounding box of record of batch, box is left, top, right, bottom */
+static void recordBox(int kind, const int * r, int box[4])
+{
+  int j;
+  switch(kind)
+  {
+  case RASTER_BATCH_PIXELS:
+    box[0] = box[2] = r[0];
+    box[1] = box[3] = r[1];
+    break;
+  case RASTER_BATCH_CIRCLES:
+    box[0] = r[0] - abs(r[2]);
+    box[1] = r[1] - abs(r[2]);
+    box[2] = r[0] + abs(r[2]);
+    box[3] = r[1] + abs(r[2]);
+    break;
+  case RASTER_BATCH_FILLELLIPSES:
+    box[0] = r[0] - abs(r[2]);
+    box[1] = r[1] - abs(r[3]);
+    box[2] = r[0] + abs(r[2]);
+    box[3] = r[1] + abs(r[3]);
+    break;
+  default:
+    /* corners of lines and bars in any order */
+    for(j = 0; j != 2; j++)
+    {
+      box[j] = r[j] < r[j + 2] ? r[j] : r[j + 2];
+      box[j + 2] = r[j] < r[j + 2] ? r[j + 2] : r[j];
+    }
+  }
+}
 
-static void setRect(RECT * r, int x1, int y1, int x2, int y2)
+/* Reports one box around all records of batch */
+static void damageBatch(int kind, int count, const int * records)
 {
-  assert(r != NULL);
-  r->left = x1;
-  r->right = x2;
-  r->top = y1;
-  r->bottom = y2;
+  int fields = RASTER_batchFields(kind), i, box[4], all[4];
+  recordBox(kind, records, all);
+  for(i = 1; i < count; i++)
+  {
+    recordBox(kind, records + i * fields, box);
+    if(box[0] < all[0])
+      all[0] = box[0];
+    if(box[1] < all[1])
+      all[1] = box[1];
+    if(box[2] > all[2])
+      all[2] = box[2];
+    if(box[3] > all[3])
+      all[3] = box[3];
+  }
+  damage(all[0], all[1], all[2], all[3]);
 }
 
-static void setWriteMode()
+/* Called when page was changed, presents it if it is visual one */
+static void endPageDraw(int page)
 {
-  int op;
-  op = XORMode ? R2_XORPEN : R2_COPYPEN; 
-  if(XORMode)
+  /* in pipeline mode render thread presents what it has drawn */
+  if(pipeline)
   {
-    SetROP2(pages[0].dc, op);
-    SetROP2(pages[1].dc, op);
-    SetROP2(windowDC, op);
+    /* it sleeps until frame is finished, but shown page must change at once */
+    if(page == publishedPage && sharedStruct->presentMode != PRESENT_MANUAL)
+      RENDER_flush();
+  }
+  else if(page == sharedStruct->visualPage)
+  {
+    BGI_presentFrame(0);
   }
 }
 
-static void unsetWriteMode()
+static void endDraw()
 {
-  SetROP2(pages[0].dc, R2_COPYPEN);
-  SetROP2(pages[1].dc, R2_COPYPEN);
-  SetROP2(windowDC, R2_COPYPEN);
+  endPageDraw(activePageIndex);
+}
+
+/**
+ * Pixel entry points are chosen by initgraph for color and drawing mode,
+ * so putpixel and getpixel do not test them on every call. Page rows
+ * are found from active page surface, viewport origin and clip come
+ * from raster context, pixels outside clip rectangle are not drawn.
+ */
+
+#define PIXEL_INSIDE(X, Y) \
+  ((unsigned)((X) - raster.clipLeft) <= (unsigned)(raster.clipRight - raster.clipLeft) && \
+   (unsigned)((Y) - raster.clipTop) <= (unsigned)(raster.clipBottom - raster.clipTop))
+
+#define PIXEL_ROW(Y) (raster.surface.bits + (raster.surface.height - (Y) - 1) * raster.surface.stride)
+
+/* Page is written directly, visual page is presented if present is set */
+#define DEFINE_PUTPIXEL(NAME, STORE, PRESENT) \
+static void NAME(int x, int y, int color) \
+{ \
+  unsigned char * row; \
+  x += raster.originX; \
+  y += raster.originY; \
+  if(!PIXEL_INSIDE(x, y)) \
+    return; \
+  row = PIXEL_ROW(y); \
+  STORE; \
+  reportDamage(x, y, x + 1, y + 1); \
+  if(PRESENT) \
+    endDraw(); \
 }
 
+#define STORE_4BPP \
+  row[x >> 1] = (unsigned char)(x & 1 \
+    ? (row[x >> 1] & 0xF0) | (color & 0xF) \
+    : (row[x >> 1] & 0x0F) | ((color & 0xF) << 4))
+#define STORE_8BPP row[x] = (unsigned char)color
+#define STORE_16BPP ((unsigned short *)row)[x] = (unsigned short)color
+#define STORE_32BPP ((unsigned *)row)[x] = (unsigned)color
+
+/* Headless mode presents pages on setvisualpage and flushgraph only */
+DEFINE_PUTPIXEL(putpixel4, STORE_4BPP, 0)
+DEFINE_PUTPIXEL(putpixel8, STORE_8BPP, 0)
+DEFINE_PUTPIXEL(putpixel16, STORE_16BPP, 0)
+DEFINE_PUTPIXEL(putpixel32, STORE_32BPP, 0)
+DEFINE_PUTPIXEL(putpixel4Present, STORE_4BPP, 1)
+DEFINE_PUTPIXEL(putpixel8Present, STORE_8BPP, 1)
+DEFINE_PUTPIXEL(putpixel16Present, STORE_16BPP, 1)
+DEFINE_PUTPIXEL(putpixel32Present, STORE_32BPP, 1)
+
+static unsigned getpixel4(int x, int y)
+{
+  x += raster.originX;
+  y += raster.originY;
+  if((unsigned)x >= (unsigned)raster.surface.width || (unsigned)y >= (unsigned)raster.surface.height)
+    return 0;
+  return (PIXEL_ROW(y)[x >> 1] >> (x & 1 ? 0 : 4)) & 0xF;
+}
+
+static unsigned getpixel8(int x, int y)
+{
+  x += raster.originX;
+  y += raster.originY;
+  if((unsigned)x >= (unsigned)raster.surface.width || (unsigned)y >= (unsigned)raster.surface.height)
+    return 0;
+  return PIXEL_ROW(y)[x];
+}
+
+static unsigned getpixel16(int x, int y)
+{
+  x += raster.originX;
+  y += raster.originY;
+  if((unsigned)x >= (unsigned)raster.surface.width || (unsigned)y >= (unsigned)raster.surface.height)
+    return 0;
+  return ((const unsigned short *)PIXEL_ROW(y))[x];
+}
+
+static unsigned getpixel32(int x, int y)
+{
+  x += raster.originX;
+  y += raster.originY;
+  if((unsigned)x >= (unsigned)raster.surface.width || (unsigned)y >= (unsigned)raster.surface.height)
+    return 0;
+  return ((const unsigned *)PIXEL_ROW(y))[x];
+}
+
+/* Pipeline mode: pixel and its damage are one command for render thread */
+static void putpixelRecorded(int x, int y, int color)
+{
+  RENDER_putPixel(&raster, activePageIndex, x, y, pixelColor(color));
+  endDraw();
+}
+
+static unsigned getpixelRecorded(int x, int y)
+{
+  /* pixel must be drawn before it is read */
+  target->finish();
+  return RASTER_getPixel(&raster, x, y);
+}
+
+/* Before initgraph and after closegraph */
+static void putpixelNone(int x, int y, int color)
+{
+}
+
+static unsigned getpixelNone(int x, int y)
+{
+  return 0;
+}
+
+static putpixelProc_t putpixelProc = putpixelNone;
+static getpixelProc_t getpixelProc = getpixelNone;
+
+static void selectPixelProcs(int initialized)
+{
+  if(!initialized)
+  {
+    putpixelProc = putpixelNone;
+    getpixelProc = getpixelNone;
+  }
+  else if(pipeline)
+  {
+    putpixelProc = putpixelRecorded;
+    getpixelProc = getpixelRecorded;
+  }
+  else if(pageBpp == 32)
+  {
+    putpixelProc = headless ? putpixel32 : putpixel32Present;
+    getpixelProc = getpixel32;
+  }
+  else if(pageBpp == 16)
+  {
+    putpixelProc = headless ? putpixel16 : putpixel16Present;
+    getpixelProc = getpixel16;
+  }
+  else if(pageBpp == 8)
+  {
+    putpixelProc = headless ? putpixel8 : putpixel8Present;
+    getpixelProc = getpixel8;
+  }
+  else
+  {
+    putpixelProc = headless ? putpixel4 : putpixel4Present;
+    getpixelProc = getpixel4;
+  }
+}
+
+#define CHECK_COLOR_RANGE(COLOR) if(!rgbMode && (COLOR < 0 || COLOR > getmaxcolor())) return;
+#define CHECK_GRAPHCS_INITED if(graphMode == -1) return;
+#define ICHECK_GRAPHCS_INITED if(graphMode == -1) return -1;
+
+#define BEGIN_DRAW  CHECK_GRAPHCS_INITED
+#define END_DRAW   endDraw();
+
 static void updatePosition(int x, int y)
 {
   currentPosition.x = x;
   currentPosition.y = y;
+#ifdef _WIN32
+  if(software)
+    return;
   MoveToEx(
     activeDC, 
     (currentPosition.x), 
     (currentPosition.y),
     NULL
     );
-  MoveToEx(
-    windowDC, 
-    (currentPosition.x), 
-    (currentPosition.y),
-    NULL
-    );
+#endif
 }
 
-static void retrivePosition()
-{
-  MoveToEx(activeDC, 0, 0, (POINT *)(void *)&currentPosition);
-  MoveToEx(activeDC, currentPosition.x, currentPosition.y, NULL);
-  
-  currentPosition.x = (currentPosition.x);
-  currentPosition.y = (currentPosition.y);
-}
+#ifdef _WIN32
 
 static int convertToBits(DWORD bits[32], int pattern)
 {
@@ -232,10 +516,11 @@ static int convertToBits(DWORD bits[32], int pattern)
   }
 }
 
-static void updatePen(int whatChanged)
+static void updateGDIPen(int whatChanged)
 {
   COLORREF c = translateColor(penColor);
   LOGBRUSH br;
+  int pc;
   DWORD bits[32] = {0};
 
   if(whatChanged & CHANGED_COLOR || whatChanged & CHANGED_STYLE || whatChanged & CHANGED_WIDTH)
@@ -270,75 +555,33 @@ static void updatePen(int whatChanged)
 
   if(whatChanged & CHANGED_COLOR)
   {
-    SetTextColor(pages[0].dc, c);
-    SetTextColor(pages[1].dc, c);
-    SetTextColor(windowDC, c);
+    for(pc = 0; pc != pageCount; pc++)
+      SetTextColor(pages[pc].dc, c);
   }
 }
 
-static void updateBrush(int whatChanged)
+static void updateGDIBrush(int whatChanged)
 {
   COLORREF c = translateColor(fillSettings.color);
+  int pc;
   if(whatChanged & CHANGED_STYLE)
   {
-  	currentBrush = stdBrushes[fillSettings.pattern];
     selectObject(stdBrushes[fillSettings.pattern], 0);
   }
   if(whatChanged & CHANGED_COLOR)
   {
-    SetBkColor(pages[0].dc, c);
-    SetBkColor(pages[1].dc, c);
-    SetBkColor(windowDC, c);
+    for(pc = 0; pc != pageCount; pc++)
+      SetBkColor(pages[pc].dc, c);
   }
 }
 
-static void updateFont()
-{
-  int opt = 0;
-  LOGFONT lf;
-  ZeroMemory(&lf, sizeof(lf));
-#if _MSC_VER >= 1400
-  strcpy_s(lf.lfFaceName, sizeof(lf.lfFaceName), "Lucida Console");
-#else
-  strcpy(lf.lfFaceName,"Lucida Console");
-#endif
-  if(textSetting.direction == VERT_DIR)
-    lf.lfEscapement = 900;
-  lf.lfWeight = (int)((textSetting.charsize + 8) * userSize.mx);
-  lf.lfHeight = (int)((textSetting.charsize + 10) * userSize.my);
-  selectObject(CreateFontIndirect(&lf), 1);
-  
-  if(textSetting.direction == HORIZ_DIR && textSetting.horiz == LEFT_TEXT)
-    opt = TA_UPDATECP;
-
-  switch(textSetting.horiz)
-  {
-  case LEFT_TEXT:
-  case RIGHT_TEXT:
-    opt |= textSetting.horiz;
-    break;
-  case CENTER_TEXT:
-    opt |= TA_CENTER;
-  }
-  switch(textSetting.vert)
-  {
-  case TOP_TEXT:
-  case BOTTOM_TEXT:
-    opt |= textSetting.vert;
-    break;
-  case CENTER_TEXT:
-    opt |= TA_CENTER;
-  }
-  SetTextAlign(pages[0].dc, opt);
-  SetTextAlign(pages[1].dc, opt);
-}
-
-static void updateViewport()
+static void updateGDIViewport()
 {
+  int pc;
   if(viewPort.clip)
   {
-	  SetViewportOrgEx(pages[0].dc, viewPort.left, viewPort.top, NULL);
-	  SetViewportOrgEx(pages[1].dc, viewPort.left, viewPort.top, NULL);
+    for(pc = 0; pc != pageCount; pc++)
+	    SetViewportOrgEx(pages[pc].dc, viewPort.left, viewPort.top, NULL);
     selectObject(
       CreateRectRgn(
         viewPort.left, 
@@ -351,14 +594,79 @@ static void updateViewport()
   }
 }
 
+#endif
+
+/* Patterns of SOLID_LINE..DASHED_LINE, bit 0 is first pixel */
+static const unsigned linePatterns[USERBIT_LINE] = {RASTER_SOLID_LINE, 0xCCCC, 0xFC78, 0xF8F8};
+
+static void updatePen(int whatChanged)
+{
+  raster.color = pixelColor(penColor);
+  if(lineSettings.linestyle == USERBIT_LINE)
+    raster.linePattern = lineSettings.upattern & 0xFFFF;
+  else
+    raster.linePattern = linePatterns[lineSettings.linestyle];
+  raster.lineWidth = lineSettings.thickness == THICK_WIDTH ? 3 : 1;
+#ifdef _WIN32
+  if(!software)
+    updateGDIPen(whatChanged);
+#endif
+}
+
+static void updateBrush(int whatChanged)
+{
+  int i;
+  unsigned char bits;
+  raster.fillColor = pixelColor(fillSettings.color);
+  for(i = 0; i != 8; i++)
+  {
+    /* builtin patterns are stored inverted since GDI draws zero bits with text color */
+    bits = (unsigned char)patternsBits[fillSettings.pattern][i];
+    raster.fillPattern[i] = fillSettings.pattern == USER_FILL ? bits : (unsigned char)~bits;
+  }
+  RASTER_expandFill(&raster);
+#ifdef _WIN32
+  if(!software)
+    updateGDIBrush(whatChanged);
+#endif
+}
+
+static void updateViewport()
+{
+  /* GDI moves origin only for clipping viewport, lines drawn by rasterizer in GDI mode must agree */
+  raster.originX = software || viewPort.clip ? viewPort.left : 0;
+  raster.originY = software || viewPort.clip ? viewPort.top : 0;
+  raster.clipLeft = 0;
+  raster.clipTop = 0;
+  raster.clipRight = windowWidth - 1;
+  raster.clipBottom = windowHeight - 1;
+  if(viewPort.clip)
+  {
+    if(viewPort.left > raster.clipLeft)
+      raster.clipLeft = viewPort.left;
+    if(viewPort.top > raster.clipTop)
+      raster.clipTop = viewPort.top;
+    if(viewPort.right < raster.clipRight)
+      raster.clipRight = viewPort.right;
+    if(viewPort.bottom < raster.clipBottom)
+      raster.clipBottom = viewPort.bottom;
+  }
+#ifdef _WIN32
+  if(!software)
+    updateGDIViewport();
+#endif
+}
+
 static void initPallette()
 {
   int i;
-  for(i = 0; i != MAXCOLORS; i++)
+#ifdef _WIN32
+  for(i = 0; i != BGI_PALETTE_SIZE; i++)
     builtinPalette[i] = RGB(BGI_palette[i].rgbRed, BGI_palette[i].rgbGreen, BGI_palette[i].rgbBlue);
-  for(i = 0; i != MAXCOLORS; i++)
+#endif
+  for(i = 0; i <= getmaxcolor(); i++)
     palette.colors[i] = i;
-  palette.size = MAXCOLORS;
+  palette.size = getmaxcolor() + 1;
 }
 
 /** 
@@ -373,18 +681,36 @@ static void initPallette()
  *             (that are tested by strstr so you can use any delimiter
  *              not use delimiters at all)
  *             "RGB" - use rgb mode instead of 16 colors
+ *             "COLORS256" - 256 colors of palette, pixels are bytes.
+ *                           Palette is applied when pages are
+ *                           presented, so changing it is cheap.
+ *             "HICOLOR" - rgb mode with 16-bit RGB565 pixels, pages
+ *                         are half the size of "RGB" ones. rgb()
+ *                         packs colors to RGB565 and getpixel returns
+ *                         them packed.
  *             "SHOW_INVISIBLE_PAGE" - two graphics window will be 
  *                                     present on the screen : normal and
  *                                     another, that always show 'invisible' page
  *             "FULL_SCREEN" - set full screen (for example for games).
+ *             "HEADLESS" - draw into pages allocated in current process,
+ *                          no window and no server are created. This is
+ *                          the only mode when built without Win32.
+ *             "PAGES=n" - number of pages, 2 (default) to 5. With more
+ *                         than two client draws next frames while
+ *                         server presents, see getnextpage().
  *
  */
 void initgraph(int * gd, int * gm, const char * path)
 {
   int options = 0;
+  const char * pagesOption;
+#ifdef _WIN32
+  int pc;
+#endif
   if(graphMode != -1) 
     closegraph();
   graphMode = *gm;
+  graphError = grOk;
   if(*gd == DETECT)
   {
     graphMode = VGAHI;
@@ -396,15 +722,53 @@ void initgraph(int * gd, int * gm, const char * path)
   }
   if(strstr(path, "SHOW_INVISIBLE_PAGE") != NULL)
     options |= MODE_SHOW_INVISIBLE_PAGE;
+#ifdef _WIN32
+  if(strstr(path, "HEADLESS") != NULL)
+    options |= MODE_HEADLESS;
+#else
+  options |= MODE_HEADLESS;
+#endif
+  headless = (options & MODE_HEADLESS) != 0;
+  if(strstr(path, "PIPELINE") != NULL)
+    options |= MODE_PIPELINE;
+  pipeline = (options & MODE_PIPELINE) != 0;
+  software = headless || pipeline;
+  target = pipeline ? &RENDER_recorder : &RENDER_direct;
+  /* like BGI drivers, .CHR files are looked for in path */
+  FONT_setPath(path);
+  /* before render thread may draw text */
+  RASTER_initFont();
+  frameFence = 0;
+  publishedPage = 0;
+  pageCount = 2;
+  pagesOption = strstr(path, "PAGES=");
+  if(pagesOption != NULL)
+  {
+    pageCount = atoi(pagesOption + 6);
+    if(pageCount < 2)
+      pageCount = 2;
+    if(pageCount > BGI_MAX_PAGES)
+      pageCount = BGI_MAX_PAGES;
+  }
+  options |= MODE_PAGES(pageCount);
   if(strstr(path, "DISABLE_DEBUG") != NULL)
     options |= MODE_RELEASE;
   else 
     options |= MODE_DEBUG;
-  if(strstr(path, "RGB") != NULL)
+  rgbMode = 0;
+  if(strstr(path, "HICOLOR") != NULL)
+  {
+    options |= MODE_HICOLOR;
+    rgbMode = 1;
+  }
+  else if(strstr(path, "RGB") != NULL)
   {
     options |= MODE_RGB;
     rgbMode = 1;
   }
+  else if(strstr(path, "COLORS256") != NULL)
+    options |= MODE_256;
+  pageBpp = MODE_BPP(options);
   if(strstr(path, "FULL_SCREEN") != NULL && *gd != CUSTOM)
     options |= MODE_FULLSCREEN;
   if(*gd == CUSTOM) {
@@ -417,156 +781,193 @@ void initgraph(int * gd, int * gm, const char * path)
 
   length = windowWidth * windowHeight / 2;
   fillSettings.pattern = SOLID_FILL;
-  if(options & MODE_RGB) {
-    penColor = RGB(255,255,255);
-    fillSettings.color = RGB(255, 255, 255);
+  if(rgbMode) {
+    penColor = rgb(255,255,255);
+    fillSettings.color = rgb(255, 255, 255);
   }
   else {
     fillSettings.color = penColor = getmaxcolor();
   }
   
-  BGI_startServer(windowWidth, windowHeight, options);
+  if(!BGI_startServer(windowWidth, windowHeight, options))
+  {
+    graphMode = -1;
+    graphError = grNoLoadMem;
+    return;
+  }
   
-  windowDC = BGI_getWindowDC();
   pages = BGI_getPages();
   initPallette();
 
   memset(&viewPort, 0, sizeof(viewPort));
   viewPort.right = getmaxx();
   viewPort.bottom = getmaxy();
+  memset(&raster, 0, sizeof(raster));
+  raster.scratch = &scratch;
+  updateViewport();
 
-  backBrush = CreateSolidBrush(0);
   sharedStruct = BGI_getSharedStruct();
-  
-  SetBkMode(pages[0].dc, TRANSPARENT);
-  SetBkMode(pages[1].dc, TRANSPARENT);
+#ifdef _WIN32
+  if(!software)
+  {
+    for(pc = 0; pc != pageCount; pc++)
+      SetBkMode(pages[pc].dc, TRANSPARENT);
+  }
+#endif
   
   setactivepage(0);
   setvisualpage(0);
-  initBrushes();
+  selectPixelProcs(1);
+#ifdef _WIN32
+  if(!software)
+    initBrushes();
+#endif
   setbkcolor(backColor);
 
   cleardevice();
   updateBrush(CHANGED_ALL);
   updatePen(CHANGED_ALL);
-  updateFont();
   updatePosition(0,0);
 }
 
-static void lineto_(int x, int y)
+/**
+ * Lines are drawn by rasterizer in GDI mode too. GDI batches calls, so
+ * it must finish them before page bits are written directly.
+ */
+static void beginRaster()
 {
-  LineTo(activeDC, x, y);
-  LineTo(activeDC, x, y);
+#ifdef _WIN32
+  if(!software)
+    GdiFlush();
+#endif
 }
 
-void arc(int x, int y, int stangle, int endangle, int radius)
+/* Draws polyline with current pen, the last point is connected to the first if closed */
+static void rasterPolyline(const RASTER_CONTEXT * ctx, int numpoints, const int * points, int closed)
 {
-  BEGIN_DRAW
-    moveto( 
-    (int)(x + radius * cos(DEG_TO_RAD(stangle))), 
-    (int)(y - radius * sin(DEG_TO_RAD(stangle)))
-    );
+  int i;
+  for(i = 0; i + 1 < numpoints; i++)
+    target->line(ctx, points[i * 2], points[i * 2 + 1], points[i * 2 + 2], points[i * 2 + 3]);
+  if(closed && numpoints > 2)
+    target->line(ctx, points[i * 2], points[i * 2 + 1], points[0], points[1]);
+}
 
-  AngleArc(
-    activeDC,
-    (x),
-    (y),
-    radius,
-    (FLOAT)stangle, 
-    (FLOAT)(endangle - stangle)
-    );
-  END_DRAW
-  /*arcCoords.x = x;
+/* Remembers arc for getarccoords */
+static void setArcCoords(int x, int y, int stangle, int endangle, int xradius, int yradius)
+{
+  arcCoords.x = x;
   arcCoords.y = y;
-  stangle *= M_PI / 360;
-  endangle *= M_PI / 360;
-  arcCoords.xstart = x + radius * cos(stangle);
-  arcCoords.ystart = y + radius * sin(stangle);
-  arcCoords.xend = x + radius * cos(endangle);
-  arcCoords.yend = y + radius * sin(endangle);*/
+  RASTER_arcPoint(x, y, stangle, xradius, yradius, &arcCoords.xstart, &arcCoords.ystart);
+  RASTER_arcPoint(x, y, endangle, xradius, yradius, &arcCoords.xend, &arcCoords.yend);
 }
 
-
-void  bar_(int left, int top, int right, int bottom)
+void arc(int x, int y, int stangle, int endangle, int radius)
 {
-  RECT r;
-  r.left = (left);
-  r.top = (top);
-  r.right = (right + 1);
-  r.bottom = (bottom + 1);
-  FillRect(activeDC, &r, currentBrush); 
+  BEGIN_DRAW
+  beginRaster();
+  target->ellipse(&raster, x, y, stangle, endangle, radius, radius);
+  damage(x - radius, y - radius, x + radius, y + radius);
+  END_DRAW
+  setArcCoords(x, y, stangle, endangle, radius, radius);
 }
 
+
 void  bar(int left, int top, int right, int bottom)
 {
-  BEGIN_FILL
-    bar_(left, top, right, bottom); 
-  END_FILL
+  BEGIN_DRAW
+  beginRaster();
+  target->bar(&raster, left, top, right, bottom);
+  damage(left, top, right, bottom);
+  END_DRAW
 }
 
 void  bar3d(int left, int top, int right, int bottom, int depth, int topflag)
 {
   int hdep = depth * 3 / 5;
-  BEGIN_FILL
-  	bar_(left, top, right, bottom);
-    if(topflag) 
+  BEGIN_DRAW
+  beginRaster();
+  target->bar(&raster, left, top, right, bottom);
+  target->rectangle(&raster, left, top, right, bottom);
+  if(depth != 0)
+  {
+    target->line(&raster, right, bottom, right + depth, bottom - hdep);
+    target->line(&raster, right + depth, bottom - hdep, right + depth, top - hdep);
+    if(topflag)
     {
-      moveto(left, top);
-      lineto_(left + depth,top - hdep);
-      lineto_(right + depth, top - hdep);
-      lineto_(right + depth, bottom - hdep);
-      lineto_(right, bottom);
-      moveto(right + depth, top - hdep);
-      lineto_(right, top);
+      target->line(&raster, right, top, right + depth, top - hdep);
+      target->line(&raster, left, top, left + depth, top - hdep);
+      target->line(&raster, left + depth, top - hdep, right + depth, top - hdep);
     }
-  END_FILL
+  }
+  /* box of both faces */
+  damage(
+    depth < 0 ? left + depth : left, 
+    hdep > 0 ? top - hdep : top, 
+    depth < 0 ? right : right + depth, 
+    hdep > 0 ? bottom : bottom - hdep
+    );
+  END_DRAW
 }
 
-void circle_(HDC dc, int x, int y, int radius)
+void  circle(int x, int y, int radius)
 {
   BEGIN_DRAW
-    Arc(
-      dc, 
-      (x - radius),
-      (y - radius),
-      (x + radius),
-      (y + radius),
-      0, 0, 0, 0
-      );
+  beginRaster();
+  target->ellipse(&raster, x, y, 0, 360, radius, radius);
+  damage(x - radius, y - radius, x + radius, y + radius);
   END_DRAW
 }
 
-void  circle(int x, int y, int radius)
+/* Fills rectangle of page (in page coordinates) with background color */
+static void clearRect(int left, int top, int right, int bottom)
 {
-  circle_(activeDC, x, y, radius);
-  if(activePageIndex == sharedStruct->visualPage)
-    circle_(windowDC, x, y, radius);
+  RASTER_CONTEXT screen = raster;
+  screen.originX = screen.originY = 0;
+  screen.clipLeft = screen.clipTop = 0;
+  screen.clipRight = windowWidth - 1;
+  screen.clipBottom = windowHeight - 1;
+  beginRaster();
+  target->clear(&screen, left, top, right, bottom, pixelColor(backColor));
+  reportDamage(left, top, right + 1, bottom + 1);
 }
 
 void  cleardevice(void)
 {
-  RECT r;
-  setRect(&r, 0, 0, windowWidth + 1, windowHeight + 1);
-  BEGIN_FILL
-    FillRect(activeDC, &r, backBrush);
-  END_FILL
+  BEGIN_DRAW
+  clearRect(0, 0, windowWidth - 1, windowHeight - 1);
+  END_DRAW
 }
 
 void  clearviewport(void)
 {
-  RECT r;
-  setRect(&r, viewPort.left, viewPort.top, viewPort.right + 1, viewPort.bottom + 1);
   BEGIN_DRAW
-    FillRect(activeDC, &r, backBrush);
+  clearRect(
+    viewPort.left < 0 ? 0 : viewPort.left,
+    viewPort.top < 0 ? 0 : viewPort.top,
+    viewPort.right < windowWidth ? viewPort.right : windowWidth - 1,
+    viewPort.bottom < windowHeight ? viewPort.bottom : windowHeight - 1
+    );
   END_DRAW
 }
 
 void  closegraph(void)
 {
+  int i;
   if(graphMode != -1)
   {
+    stopcapture();
     BGI_closeWindow();
+    RASTER_freeScratch(&scratch);
+    for(i = 0; i != BGI_MAX_PAGES; i++)
+    {
+      BGI_free(pageRows[i]);
+      pageRows[i] = NULL;
+    }
+    selectPixelProcs(0);
+    FONT_free();
+    textSetting.font = DEFAULT_FONT;
     graphMode = -1;
+    graphError = grOk;
   }
   //SetFocus(GetConsoleWindow());
 }
@@ -577,86 +978,56 @@ void  detectgraph(int  *graphdriver,int  *graphmode)
   *graphmode = VGAHI;
 }
 
-#define BEGIN_LINEDRAW setWriteMode();
-#define END_LINEDRAW unsetWriteMode(); 
+#define BEGIN_LINEDRAW BEGIN_DRAW beginRaster();
+#define END_LINEDRAW END_DRAW
 
 void  drawpoly(int numpoints, const int  *polypoints)
 {
-  int i;
-  POINT * points;
-  CHECK_GRAPHCS_INITED
-  points = malloc(numpoints * sizeof(POINT));
-  for(i = 0; i != numpoints; i++)
-  {
-    points[i].x = (*polypoints++);
-    points[i].y = (*polypoints++);
-  }
   BEGIN_LINEDRAW
-    Polyline(activeDC, points, numpoints);
+  rasterPolyline(&raster, numpoints, polypoints, 0);
+  damagePoints(numpoints, polypoints);
   END_LINEDRAW
-  free(points);
 }
 
-void ellipse_(HDC dc, int x, int y, int stangle, int endangle, int xradius, int yradius)
-{
-  Arc(
-    dc,
-    (x - xradius), 
-    (y - yradius),
-    (x + xradius),
-    (y + yradius),
-    (x + xradius * cos(DEG_TO_RAD(stangle))),
-    (y - yradius * sin(DEG_TO_RAD(stangle))),
-    (x + xradius * cos(DEG_TO_RAD(endangle))),
-    (y - yradius * sin(DEG_TO_RAD(endangle)))
-    );
-}
 void  ellipse(int x, int y, int stangle, int endangle, int xradius, int yradius)
 {
   BEGIN_DRAW
-    ellipse_(activeDC, x, y, stangle, endangle, xradius, yradius);
+  beginRaster();
+  target->ellipse(&raster, x, y, stangle, endangle, xradius, yradius);
+  damage(x - xradius, y - yradius, x + xradius, y + yradius);
   END_DRAW
-  if(activePageIndex == sharedStruct->visualPage)
-    ellipse_(windowDC, x, y, stangle, endangle, xradius, yradius);
-  arcCoords.x = x;
-  arcCoords.y = y;
+  setArcCoords(x, y, stangle, endangle, xradius, yradius);
 }
 
 void  fillellipse( int x, int y, int xradius, int yradius )
 {
-  BEGIN_FILL
-      Ellipse(
-        activeDC,
-        (x - xradius),
-        (y - yradius),
-        (x + xradius),
-        (y + yradius)
-        );
-  END_FILL
+  BEGIN_DRAW
+  beginRaster();
+  target->fillEllipse(&raster, x, y, xradius, yradius);
+  damage(x - xradius, y - yradius, x + xradius, y + yradius);
+  END_DRAW
 }
 
 void  fillpoly(int numpoints, const int  *polypoints)
 {
-  int i;
-  POINT * points;
-  CHECK_GRAPHCS_INITED
-  points = malloc(numpoints * sizeof(POINT));
-  for(i = 0; i != numpoints; i++)
-  {
-    points[i].x = (*polypoints++);
-    points[i].y = (*polypoints++);
-  }
-  BEGIN_FILL
-      Polygon(activeDC, points, numpoints);
-  END_FILL
-  free(points);
+  RASTER_CONTEXT outline = raster;
+  BEGIN_DRAW
+  beginRaster();
+  outline.writeMode = RASTER_COPY;
+  target->fillPoly(&raster, numpoints, polypoints);
+  rasterPolyline(&outline, numpoints, polypoints, 1);
+  damagePoints(numpoints, polypoints);
+  END_DRAW
 }
 
 void  floodfill(int x, int y, int border)
 {
-  BEGIN_FILL
-     ExtFloodFill(activeDC, x, y, translateColor(border), FLOODFILLBORDER);
-  END_FILL
+  BEGIN_DRAW
+  beginRaster();
+  if(!target->floodFill(&raster, x, y, pixelColor(border)))
+    graphError = grNoFloodMem;
+  damageClip();
+  END_DRAW
 }
 
 void  getarccoords(g_arccoordstype  *arccoords)
@@ -708,16 +1079,14 @@ int getgraphmode(void)
 
 void  getimage(int left, int top, int right, int bottom,void  *bitmap)
 {
-  int x, y;
   int * bits = (int *) bitmap;
-  int width = right - left;
-  int height = bottom - top;
-  int c;
-  *bits++ = width;
-  *bits++ = height;
-  for(y = top; y <= bottom; y++)
-    for(x = left; x <= right ; x++)
-      *bits++ = c = getpixel(x, y);
+  bits[0] = right - left;
+  bits[1] = bottom - top;
+  CHECK_GRAPHCS_INITED
+  beginRaster();
+  /* image must be drawn before it is read */
+  target->finish();
+  RASTER_getImage(&raster, left, top, right - left + 1, bottom - top + 1, (unsigned *)bits + 2);
 }
 
 void  getlinesettings(g_linesettingstype  *lineinfo)
@@ -727,7 +1096,7 @@ void  getlinesettings(g_linesettingstype  *lineinfo)
 
 int getmaxcolor(void)
 {
-  return MAXCOLORS - 1;
+  return pageBpp == 8 ? MAXCOLORS256 - 1 : MAXCOLORS - 1;
 }
 
 int getmaxmode(void)
@@ -776,18 +1145,7 @@ void  getmoderange(int graphdriver, int  *lomode, int *himode)
 
 unsigned getpixel(int x, int y)
 {
-  x = (x);
-  y = (y);
-  if(rgbMode) {
-    return ((unsigned *)activeBits)[x + (windowHeight - y - 1) * windowWidth];
-  } else {
-    int index = (x) + (windowHeight - (y) - 1) * windowWidth;
-    int delta = index % 2 ? 0 : 4;
-    if(x >= 0 && x < windowWidth && y >= 0 && y < windowHeight) {
-      return (activeBits[index / 2] & (0xF << delta)) >> delta;
-    }
-  }
-  return 0;
+  return getpixelProc(x, y);
 }
 
 void  getpalette(g_palettetype  * _palette)
@@ -797,7 +1155,7 @@ void  getpalette(g_palettetype  * _palette)
 
 int getpalettesize( void )
 {
-  return sizeof(palette);
+  return getmaxcolor() + 1;
 }
 
 void  gettextsettings(g_textsettingstype  *texttypeinfo)
@@ -824,12 +1182,30 @@ char *  grapherrormsg(int errorcode)
 {
   if(errorcode == grNoInitGraph)
     return "Graphics in not initialized";
+  if(errorcode == grNoLoadMem)
+    return "Not enough memory to load driver";
+  if(errorcode == grNoFloodMem)
+    return "Out of memory in flood fill";
+  if(errorcode == grFontNotFound)
+    return "Font file not found";
+  if(errorcode == grNoFontMem)
+    return "Not enough memory to load font";
+  if(errorcode == grInvalidFont)
+    return "Invalid font file";
+  if(errorcode == grInvalidFontNum)
+    return "Invalid font number";
   return "OK";
 }
 
+/* Returns and resets error of last failed operation */
 int graphresult(void)
 {
-  return graphMode != -1 ? grOk : grNoInitGraph;
+  int result = graphError;
+  graphError = grOk;
+  /* failed initgraph tells why it failed */
+  if(graphMode == -1 && result == grOk)
+    return grNoInitGraph;
+  return result;
 }
 
 unsigned imagesize(int left, int top, int right, int bottom)
@@ -837,46 +1213,27 @@ unsigned imagesize(int left, int top, int right, int bottom)
   return (abs((right - left + 1) * (bottom - top + 1))  + 2) * sizeof(int);
 }
 
-void lineto__(HDC dc, int x, int y)
-{
-  LineTo(dc, (x), (y));
-}
-void line_(HDC dc, int x1, int y1, int x2, int y2)
-{
-  MoveToEx(dc, (x1), (y1), NULL);
-  lineto__(dc, x2, y2);
-  SetPixelV(dc, (x2), (y2), translateColor(penColor));
-}
-
 void  line(int x1, int y1, int x2, int y2)
 {
   BEGIN_LINEDRAW
-    line_(activeDC, x1, y1, x2, y2);
-    if(sharedStruct->visualPage == activePageIndex)
-      line_(windowDC, x1, y1, x2, y2);
+  target->line(&raster, x1, y1, x2, y2);
+  damage(x1, y1, x2, y2);
   END_LINEDRAW
-  currentPosition.x = x2;
-  currentPosition.y = y2;
+  updatePosition(x2, y2);
 }
 
 void  linerel(int dx, int dy)
 {
-  BEGIN_LINEDRAW
-    lineto__(activeDC, currentPosition.x + dx, currentPosition.y + dy);
-    if(sharedStruct->visualPage == activePageIndex)
-      lineto__(windowDC, currentPosition.x += dx, currentPosition.y += dy);
-  END_LINEDRAW
+  lineto(currentPosition.x + dx, currentPosition.y + dy);
 }
 
 void  lineto(int x, int y)
 {
   BEGIN_LINEDRAW
-    lineto__(activeDC, x, y);
-    if(sharedStruct->visualPage == activePageIndex)
-      lineto__(windowDC, x, y);
+  target->line(&raster, currentPosition.x, currentPosition.y, x, y);
+  damage(currentPosition.x, currentPosition.y, x, y);
   END_LINEDRAW
-  currentPosition.x = x;
-  currentPosition.y = y;
+  updatePosition(x, y);
 }
 
 void  moverel(int dx, int dy)
@@ -890,137 +1247,198 @@ void  moveto(int x, int y)
   updatePosition(x, y);
 }
 
+/* Size of builtin font is 8x8 pixels multiplied by charsize */
+static int rasterTextSize()
+{
+  return textSetting.charsize > 1 ? textSetting.charsize : 1;
+}
+
+/* Stroked fonts: charsize 4 is size of font file, USER_CHAR_SIZE is scaled by setusercharsize */
+static void strokedStyle(FONT_STYLE * style)
+{
+  static const int scales[10][2] = {{3, 5}, {2, 3}, {3, 4}, {1, 1}, {4, 3}, {5, 3}, {2, 1}, {5, 2}, {3, 1}, {4, 1}};
+  int size = textSetting.charsize > 10 ? 10 : textSetting.charsize;
+  style->font = textSetting.font;
+  style->vertical = textSetting.direction == VERT_DIR;
+  if(size <= USER_CHAR_SIZE)
+  {
+    style->sx = userSize.mx;
+    style->sy = userSize.my;
+  }
+  else
+  {
+    style->sx = style->sy = scales[size - 1][0] / (double)scales[size - 1][1];
+  }
+}
+
 void  outtext(const char  *textstring)
 {
   BEGIN_DRAW
     outtextxy(currentPosition.x, currentPosition.y, textstring);
+    if(textSetting.direction == HORIZ_DIR && textSetting.horiz == LEFT_TEXT)
+      updatePosition(currentPosition.x + textwidth(textstring), currentPosition.y);
   END_DRAW
 }
 
+/* Strokes of text with top left corner (bottom left for vertical text) at (x, y) are drawn as solid thin lines */
+static void strokedText(int x, int y, const char * textstring)
+{
+  FONT_STYLE style;
+  const int * lines;
+  int count;
+  unsigned linePattern = raster.linePattern;
+  int lineWidth = raster.lineWidth, writeMode = raster.writeMode;
+  strokedStyle(&style);
+  lines = FONT_lines(&style, textstring, x, y, (int)raster.color, &count);
+  if(lines == NULL)
+  {
+    graphError = grNoFontMem;
+    return;
+  }
+  if(count == 0)
+    return;
+  raster.linePattern = 0xFFFF;
+  raster.lineWidth = 1;
+  raster.writeMode = RASTER_COPY;
+  target->batch(&raster, RASTER_BATCH_LINES, count, lines);
+  raster.linePattern = linePattern;
+  raster.lineWidth = lineWidth;
+  raster.writeMode = writeMode;
+  damageBatch(RASTER_BATCH_LINES, count, lines);
+}
+
+/* (x, y) is justified by settextjustify */
 void  outtextxy(int x, int y, const char  *textstring)
 {
-  BOOL r;
+  int w, h, t, vertical = textSetting.direction == VERT_DIR;
   BEGIN_DRAW
-    moveto(x, y);
-    r = TextOut(
-      activeDC,
-      (x),
-      (y),
-      textstring,
-      (int)strlen(textstring)
-      );
-    retrivePosition();
+  w = textwidth(textstring);
+  h = textheight(textstring);
+  if(vertical)
+  {
+    t = w; w = h; h = t;
+  }
+  if(textSetting.horiz == CENTER_TEXT)
+    x -= w / 2;
+  else if(textSetting.horiz == RIGHT_TEXT)
+    x -= w - 1;
+  if(textSetting.vert == CENTER_TEXT)
+    y -= h / 2;
+  else if(textSetting.vert == BOTTOM_TEXT)
+    y -= h - 1;
+  /* vertical text is written from bottom to top */
+  if(vertical)
+    y += h - 1;
+  beginRaster();
+  if(textSetting.font != DEFAULT_FONT)
+  {
+    strokedText(x, y, textstring);
+  }
+  else
+  {
+    target->text(&raster, x, y, textstring, rasterTextSize(), vertical);
+    damage(x, vertical ? y - h + 1 : y, x + w - 1, vertical ? y : y + h - 1);
+  }
   END_DRAW
 }
 
 void  pieslice(int x, int y, int stangle, int endangle, int radius)
 {
+  sector(x, y, stangle, endangle, radius, radius);
+}
+
+void  putimage(int left, int top, const void  *bitmap, int op)
+{
+  int width = ((int *)bitmap)[0], height = ((int *)bitmap)[1];
   BEGIN_DRAW
-    Pie(
-      activeDC, 
-      (x - radius), 
-      (y - radius), 
-      (x + radius), 
-      (y + radius), 
-      ((int)(x + radius * cos(DEG_TO_RAD(stangle)))), 
-      ((int)(y - radius * sin(DEG_TO_RAD(stangle)))),
-      ((int)(x + radius * cos(DEG_TO_RAD(endangle)))), 
-      ((int)(y - radius * sin(DEG_TO_RAD(endangle))))
-      );
+  beginRaster();
+  /* getimage stores right - left and bottom - top, bounds are inclusive */
+  target->putImage(
+    &raster, 
+    left, 
+    top, 
+    width + 1, 
+    height + 1, 
+    (const unsigned *)bitmap + 2, 
+    op >= COPY_PUT && op <= NOT_PUT ? op : COPY_PUT
+    );
+  damage(left, top, left + width, top + height);
   END_DRAW
 }
 
-#define PUTPIXEL_16(X,Y,COLOR, OP) {\
-  int index = X + (windowHeight - Y - 1) * windowWidth;\
-  int delta = X % 2 ? 0 : 4;\
-  activeBits[index / 2] OP (BYTE)((COLOR & 0xF) << delta);\
+void * createsprite(const void * bitmap, int colorkey)
+{
+  const int * bits = (const int *)bitmap;
+  if(graphMode == -1)
+    return NULL;
+  /* sprite is compiled for pixel format of pages */
+  return RASTER_createSprite((const unsigned *)bits + 2, bits[0] + 1, bits[1] + 1, pixelColor(colorkey), raster.surface.bpp);
 }
 
-#define PUTPIXEL_RGB(X,Y,COLOR, OP) {\
-  ((int *)activeBits)[X + (windowHeight - Y - 1) * windowWidth] OP COLOR;\
+void drawsprite(int left, int top, const void * sprite)
+{
+  const RASTER_SPRITE * compiled = (const RASTER_SPRITE *)sprite;
+  if(sprite == NULL)
+    return;
+  BEGIN_DRAW
+  beginRaster();
+  target->drawSprite(&raster, left, top, compiled);
+  damage(left, top, left + compiled->width - 1, top + compiled->height - 1);
+  END_DRAW
 }
 
+void freesprite(void * sprite)
+{
+  RASTER_freeSprite((RASTER_SPRITE *)sprite);
+}
 
-static void putpixelCOPY(int x, int y, int color)
+/* Whole batch is drawn with one damage report and one present */
+static void drawBatch(int kind, int count, const int * records)
 {
-  int index = x + (windowHeight - y-1) * windowWidth ;
-  int delta = x % 2 ? 0 : 4;
-  activeBits[index / 2] &= 0xF0 >> delta;
-  activeBits[index / 2] |= (color & 0xF) << delta;
+  BEGIN_DRAW
+  if(count <= 0)
+    return;
+  beginRaster();
+  target->batch(&raster, kind, count, records);
+  damageBatch(kind, count, records);
+  END_DRAW
 }
 
-static void putpixelXOR(int x, int y, int color)
+void putpixels(int count, const int * pixels)
 {
-  PUTPIXEL_16(x, y, color, ^=);
+  drawBatch(RASTER_BATCH_PIXELS, count, pixels);
 }
 
-void  putimage(int left, int top, const void  *bitmap, int op)
+void drawlines(int count, const int * lines)
 {
-  typedef void ( *PUTPIXEL_PROC)(int x, int y, int color);
-  
-  int x, y, width = ((int *)bitmap)[0], height = ((int *)bitmap)[1];
-  int * color= (int *)bitmap + 2;
-  int maxx, maxy;
-  maxy = top + height < windowHeight ? top + height : windowHeight;
-  maxx = left + width < windowWidth ? left + width : windowWidth;
+  drawBatch(RASTER_BATCH_LINES, count, lines);
+}
 
-  BEGIN_DRAW
-   if(rgbMode) {
-        if(op == COPY_PUT) {
-          for(y = top; y <= maxy; y++) 
-            for(x = left; x <= maxx; x++)
-              if( y >= 0 && y <= windowHeight && x >= 0 && y <= windowWidth)
-               putpixelCOPY(x, y, *color++);
-        } else {
-          for(y = top; y <= maxy; y++) 
-            for(x = left; x <= maxx; x++)
-              if( y >= 0 && y <= windowHeight && x >= 0 && y <= windowWidth)
-                putpixelXOR(x, y, *color++);
-        }
-   } else {
-        if(op == COPY_PUT) {
-          for(y = top; y <= maxy; y++) 
-            for(x = left; x <= maxx; x++)
-              if( y >= 0 && y <= windowHeight && x >= 0 && y <= windowWidth)
-                PUTPIXEL_RGB(x, y, *color++, =);
-        } else {
-          for(y = top; y <= maxy; y++) 
-            for(x = left; x <= maxx; x++)
-              if( y >= 0 && y <= windowHeight && x >= 0 && y <= windowWidth)
-                PUTPIXEL_RGB(x, y, *color++, ^=);
-        }
-   }
-  END_DRAW
+void bars(int count, const int * bars)
+{
+  drawBatch(RASTER_BATCH_BARS, count, bars);
+}
+
+void circles(int count, const int * circles)
+{
+  drawBatch(RASTER_BATCH_CIRCLES, count, circles);
+}
+
+void fillellipses(int count, const int * ellipses)
+{
+  drawBatch(RASTER_BATCH_FILLELLIPSES, count, ellipses);
 }
 
 void  putpixel(int x, int y, int color)
 {
-  //static counter = 0;
-  CHECK_GRAPHCS_INITED
-  x = (x);
-  y = (y);
-  if(rgbMode) 
-  {
-    ((unsigned *)activeBits)[x + (windowHeight - y - 1) * windowWidth] = color;
-    //SetPixelV(activeDC, (x), (y), translateColor(color));
-  }
-  else
-  {
-    if(x >= 0 && x < windowWidth && y >= 0 && y < windowHeight)
-      putpixelCOPY(x, y, color);
-  }
-  if(activePageIndex == sharedStruct->visualPage)
-    SetPixelV(windowDC, x, y, translateColor(color));
+  putpixelProc(x, y, color);
 }
 
 void  rectangle(int left, int top, int right, int bottom)
 {
   BEGIN_LINEDRAW
-    moveto(left, top);
-    lineto_(right, top);
-    lineto_(right, bottom);
-    lineto_(left, bottom);
-    lineto_(left, top);
+  target->rectangle(&raster, left, top, right, bottom);
+  damage(left, top, right, bottom);
   END_LINEDRAW
   updatePosition(right, bottom);
 }
@@ -1028,45 +1446,44 @@ void  rectangle(int left, int top, int right, int bottom)
 void  sector( int X, int Y, int StAngle, int EndAngle, int XRadius, int YRadius )
 {
   BEGIN_DRAW
-    moveto(
-      (cos(DEG_TO_RAD(StAngle)) * XRadius), 
-      (sin(DEG_TO_RAD(StAngle)) * YRadius)
-      );
-    Pie(
-      activeDC, 
-      (X - XRadius), 
-      (Y - YRadius), 
-      (X + XRadius), 
-      (Y + YRadius), 
-      (X + cos(DEG_TO_RAD(StAngle)) * XRadius),
-      (Y - sin(DEG_TO_RAD(StAngle)) * YRadius),
-      (X + cos(DEG_TO_RAD(EndAngle)) * XRadius),
-      (Y - sin(DEG_TO_RAD(EndAngle)) * YRadius)
-      );
+  beginRaster();
+  target->sector(&raster, X, Y, StAngle, EndAngle, XRadius, YRadius);
+  damage(X - XRadius, Y - YRadius, X + XRadius, Y + YRadius);
   END_DRAW
+  setArcCoords(X, Y, StAngle, EndAngle, XRadius, YRadius);
 }
 
 void  setactivepage(int page)
 {
   CHECK_GRAPHCS_INITED
 
-  if(page == 0 || page == 1)
+  if(page >= 0 && page < pageCount)
   {
     activeDC = pages[page].dc;
     activePageIndex = page;
     activeBits = (unsigned char *)pages[page].bits;
+    RASTER_initSurface(&raster.surface, activeBits, windowWidth, windowHeight, pageBpp);
   }
 }
 
 void  setallpalette(const g_palettetype  * _palette)
 {
-  int i;
+  int i, size;
   CHECK_GRAPHCS_INITED
-  for(i = 0; i != _palette->size; i++)
-    BGI_palette[i] = BGI_default_palette[_palette->colors[i]];
-  SetDIBColorTable(pages[0].dc, 0, MAXCOLORS, BGI_palette);
-  SetDIBColorTable(pages[1].dc, 0, MAXCOLORS, BGI_palette);
-  SendMessage(BGI_getWindow(), WM_MYPALETTECHANGED, 0, _palette->size);
+  size = _palette->size <= getmaxcolor() + 1 ? _palette->size : getmaxcolor() + 1;
+  if(size < 0)
+    size = 0;
+  for(i = 0; i < size; i++)
+    BGI_palette[i] = BGI_default_palette[_palette->colors[i] % BGI_PALETTE_SIZE];
+#ifdef _WIN32
+  if(headless)
+    return;
+  for(i = 0; i < size; i++)
+    builtinPalette[i] = RGB(BGI_palette[i].rgbRed, BGI_palette[i].rgbGreen, BGI_palette[i].rgbBlue);
+  for(i = 0; i != pageCount; i++)
+    SetDIBColorTable(pages[i].dc, 0, size, BGI_palette);
+  BGI_postControl(BGI_CONTROL_PALETTE, 0, size);
+#endif
 }
 
 void  setaspectratio(int xasp, int yasp)
@@ -1080,8 +1497,8 @@ void  setbkcolor(int color)
   CHECK_GRAPHCS_INITED
   CHECK_COLOR_RANGE(color)
   backColor = color;
-  DeleteObject(backBrush);
-  backBrush = CreateSolidBrush(translateColor(color));
+  raster.backColor = pixelColor(color);
+  RASTER_expandFill(&raster);
 }
 
 void  setcolor(int color)
@@ -1095,17 +1512,27 @@ void  setcolor(int color)
 void  setfillpattern(const char  *upattern, int color)
 {
   int i;
-  HANDLE old;
+#ifdef _WIN32
+  HANDLE old = NULL;
+#endif
   CHECK_GRAPHCS_INITED
   CHECK_COLOR_RANGE(color)
   for(i = 0; i != 8; i++)
     patternsBits[USER_FILL][i] = upattern[i];
-  old = stdBrushes[USER_FILL];
-  stdBrushes[USER_FILL] = CreatePatternBrush(CreateBitmap(8,8,1,1,(LPBYTE)patternsBits[USER_FILL]));
+#ifdef _WIN32
+  if(!software)
+  {
+    old = stdBrushes[USER_FILL];
+    stdBrushes[USER_FILL] = CreatePatternBrush(CreateBitmap(8,8,1,1,(LPBYTE)patternsBits[USER_FILL]));
+  }
+#endif
   fillSettings.color = color;
   fillSettings.pattern = USER_FILL;
   updateBrush(CHANGED_ALL);
-  DeleteObject(old);
+#ifdef _WIN32
+  if(old != NULL)
+    DeleteObject(old);
+#endif
 }
 
 void  setfillstyle(int pattern, int color)
@@ -1127,12 +1554,24 @@ void  setfillstyle(int pattern, int color)
   }
 }
 
+void  setfillrule(int rule)
+{
+  CHECK_GRAPHCS_INITED
+  raster.fillRule = rule == FILLRULE_NONZERO ? RASTER_NONZERO : RASTER_EVENODD;
+}
+
+int  getfillrule(void)
+{
+  return raster.fillRule == RASTER_NONZERO ? FILLRULE_NONZERO : FILLRULE_EVENODD;
+}
+
 void  setlinestyle(int linestyle, unsigned upattern, int thickness)
 {
   CHECK_GRAPHCS_INITED
   if(linestyle >= 0 && linestyle <= USERBIT_LINE)
     lineSettings.linestyle = linestyle;
-  if(linestyle == USERBIT_LINE)
+#ifdef _WIN32
+  if(linestyle == USERBIT_LINE && !software)
   {
     HPEN pen;
     LOGBRUSH br;
@@ -1150,6 +1589,7 @@ void  setlinestyle(int linestyle, unsigned upattern, int thickness)
       );
     DeleteObject(stdPens[USERBIT_LINE]);
   }
+#endif
   lineSettings.upattern = upattern;
   lineSettings.thickness = thickness;
   updatePen(CHANGED_ALL);
@@ -1157,19 +1597,29 @@ void  setlinestyle(int linestyle, unsigned upattern, int thickness)
 
 void  setpalette(int colornum, int color)
 {
+#ifdef _WIN32
+  int pc;
+#endif
   CHECK_GRAPHCS_INITED
   if(!rgbMode)
   {
     CHECK_COLOR_RANGE(colornum)
     BGI_palette[colornum] = BGI_default_palette[color];
-    SetDIBColorTable(pages[0].dc, colornum, 1, BGI_palette + colornum);
-    SetDIBColorTable(pages[1].dc, colornum, 1, BGI_palette + colornum);
-    SendMessage(BGI_getWindow(), WM_MYPALETTECHANGED, colornum, 1);
+#ifdef _WIN32
+    if(headless)
+      return;
+    for(pc = 0; pc != pageCount; pc++)
+      SetDIBColorTable(pages[pc].dc, colornum, 1, BGI_palette + colornum);
+    BGI_postControl(BGI_CONTROL_PALETTE, colornum, 1);
+#endif
   }
 }
 
 void  setrgbpalette(int colornum, int red, int green, int blue)
 {
+#ifdef _WIN32
+  int pc;
+#endif
   CHECK_GRAPHCS_INITED
   if(!rgbMode)
   {
@@ -1177,10 +1627,14 @@ void  setrgbpalette(int colornum, int red, int green, int blue)
     BGI_palette[colornum].rgbRed = (BYTE)red;
     BGI_palette[colornum].rgbGreen = (BYTE)green;
     BGI_palette[colornum].rgbBlue = (BYTE)blue;
+#ifdef _WIN32
+    if(headless)
+      return;
     builtinPalette[colornum] = RGB(red, green, blue);
-    SetDIBColorTable(pages[0].dc, colornum, 1, BGI_palette + colornum);
-    SetDIBColorTable(pages[1].dc, colornum, 1, BGI_palette + colornum);
-    SendMessage(BGI_getWindow(), WM_MYPALETTECHANGED, colornum, 1);
+    for(pc = 0; pc != pageCount; pc++)
+      SetDIBColorTable(pages[pc].dc, colornum, 1, BGI_palette + colornum);
+    BGI_postControl(BGI_CONTROL_PALETTE, colornum, 1);
+#endif
   }
 }
 
@@ -1189,16 +1643,22 @@ void  settextjustify(int horiz, int vert)
   CHECK_GRAPHCS_INITED
   textSetting.horiz = horiz;
   textSetting.vert = vert;
-  updateFont();
 }
 
 void  settextstyle(int font, int direction, int charsize)
 {
+  int result;
   CHECK_GRAPHCS_INITED
+  result = font == DEFAULT_FONT ? grOk : FONT_load(font);
+  /* font that can not be loaded is replaced by builtin one */
+  if(result != grOk)
+  {
+    graphError = result;
+    font = DEFAULT_FONT;
+  }
   textSetting.font = font;
   textSetting.direction = direction;
   textSetting.charsize = charsize;
-  updateFont();
 }
 
 void  setusercharsize(int multx, int divx, int multy, int divy)
@@ -1222,12 +1682,35 @@ void  setviewport(int left, int top, int right, int bottom, int clip)
   updateViewport();
 }
 
+static void capturePendingFrame(void)
+{
+  if(capturePending == -1)
+    return;
+  CAPTURE_frame(pages[capturePending].bits, BGI_palette);
+  capturePending = -1;
+}
+
 void  setvisualpage(int page)
 {
   CHECK_GRAPHCS_INITED
-  if(page == 0 || page == 1)
+  if(page >= 0 && page < pageCount)
   {
-    BGI_setVisualPage(page);
+    publishedPage = page;
+    if(pipeline)
+    {
+      /* client may be one frame ahead of render thread, not more */
+      RENDER_wait(frameFence);
+      /* previous frame is drawn now, so it is captured without waiting for this one */
+      capturePendingFrame();
+      frameFence = RENDER_showPage(page);
+      if(CAPTURE_active())
+        capturePending = page;
+    }
+    else
+    {
+      BGI_setVisualPage(page);
+      CAPTURE_frame(pages[page].bits, BGI_palette);
+    }
     frameCounter++;
     if(clock() >= lastMeasuredTime + CLOCKS_PER_SEC)
     {
@@ -1235,44 +1718,65 @@ void  setvisualpage(int page)
       frameCounter = 0;
       lastMeasuredTime = clock();
     }
-    BGI_updateWindow();
+    if(!pipeline)
+      BGI_presentFrame(0);
   }
 }
 
 void  setwritemode( int mode )
 {
   XORMode = mode == XOR_PUT;
+  raster.writeMode = XORMode ? RASTER_XOR : RASTER_COPY;
 }
 
+/* Metrics are arithmetic on font tables, nothing is rendered to measure text */
 int textheight(const char  *textstring)
 {
-  SIZE size;
+  FONT_STYLE style;
   ICHECK_GRAPHCS_INITED
-  GetTextExtentPoint(activeDC, textstring, (int)strlen(textstring), &size);
-  return size.cy;
+  if(textSetting.font != DEFAULT_FONT)
+  {
+    strokedStyle(&style);
+    return FONT_height(&style);
+  }
+  return RASTER_FONT_SIZE * rasterTextSize();
 }
 
 int textwidth(const char  *textstring)
 {
-  SIZE size;
+  FONT_STYLE style;
   ICHECK_GRAPHCS_INITED
-  GetTextExtentPoint(activeDC, textstring, (int)strlen(textstring), &size);
-  return size.cx;
+  if(textSetting.font != DEFAULT_FONT)
+  {
+    strokedStyle(&style);
+    return FONT_width(&style, textstring);
+  }
+  return RASTER_FONT_SIZE * rasterTextSize() * (int)strlen(textstring);
 }
 
 void delay(int miliSeconds)
 {
+#ifdef _WIN32
   Sleep(miliSeconds);
+#else
+  usleep(miliSeconds * 1000);
+#endif
 }
 
 int anykeypressed()
 {
-  return sharedStruct->keyCode != -1;
+  if(graphMode == -1)
+    return 0;
+  return BGI_anyKeyPressed();
 }
 
 int keypressed(int key)
 {
-  return GetAsyncKeyState(key);
+#ifdef _WIN32
+  if(!headless)
+    return GetAsyncKeyState(key);
+#endif
+  return 0;
 }
 
 void getmousestate(g_mousestate * state)
@@ -1285,11 +1789,20 @@ void getmousestate(g_mousestate * state)
 
 void setmousepos(int x, int y)
 {
+#ifdef _WIN32
   RECT r;
+#endif
   CHECK_GRAPHCS_INITED
-  
+  if(headless)
+  {
+    sharedStruct->mouseX = x;
+    sharedStruct->mouseY = y;
+    return;
+  }
+#ifdef _WIN32
   GetWindowRect(BGI_getWindow(), &r);
   SetCursorPos(r.left + x, r.top + y);
+#endif
 }
 
 int readkey()
@@ -1298,8 +1811,204 @@ int readkey()
   return BGI_getch();
 }
 
+int getevent(g_event * event)
+{
+  BGI_EVENT e;
+  if(graphMode == -1 || !BGI_getEvent(&e))
+    return 0;
+  event->type = e.type;
+  event->time = e.time;
+  event->key = e.key;
+  event->letter = e.letter;
+  event->x = e.x;
+  event->y = e.y;
+  event->buttons = e.buttons;
+  return 1;
+}
+
+void setpresentmode(int mode, int rate)
+{
+  CHECK_GRAPHCS_INITED
+  if(mode < PRESENT_IMMEDIATE || mode > PRESENT_MANUAL)
+    return;
+  if(rate <= 0)
+    rate = PRESENT_DEFAULT_RATE;
+  /* server clock period is 1000 / rate milliseconds, it must not be 0 */
+  if(rate > PRESENT_MAX_RATE)
+    rate = PRESENT_MAX_RATE;
+  sharedStruct->presentRate = rate;
+  sharedStruct->presentMode = mode;
+  if(headless)
+    BGI_restartFrameClock();
+#ifdef _WIN32
+  /* server sets its frame clock */
+  if(!headless)
+    BGI_postControl(BGI_CONTROL_PRESENT, mode, rate);
+#endif
+}
+
+void flushgraph(void)
+{
+  CHECK_GRAPHCS_INITED
+  if(pipeline)
+    RENDER_present();
+  else
+    BGI_presentFrame(1);
+}
+
+void getpresentstats(g_presentstats * stats)
+{
+  BGI_DAMAGE * damage;
+  memset(stats, 0, sizeof(*stats));
+  CHECK_GRAPHCS_INITED
+  /* in pipeline mode damage is reported by render thread */
+  target->finish();
+  damage = &sharedStruct->damage;
+  stats->frames = damage->frames;
+  stats->presents = damage->presents;
+  stats->rects = damage->rectsPresented;
+  stats->bytes = damage->bytesPresented;
+  stats->lastframebytes = damage->lastFrameBytes;
+}
+
+int startcapture(const char * path, int format)
+{
+  if(graphMode == -1 || format < CAPTURE_RAW || format > CAPTURE_DELTA)
+    return 0;
+  capturePending = -1;
+  return CAPTURE_start(path, format, windowWidth, windowHeight, pageBpp);
+}
+
+void stopcapture(void)
+{
+  if(!CAPTURE_active())
+    return;
+  if(capturePending != -1)
+  {
+    target->finish();
+    capturePendingFrame();
+  }
+  CAPTURE_stop();
+}
+
+void getcapturestats(g_capturestats * stats)
+{
+  CAPTURE_stats(&stats->frames, &stats->dropped, &stats->bytes);
+}
+
+int getmaxpage(void)
+{
+  ICHECK_GRAPHCS_INITED
+  return pageCount - 1;
+}
+
+/* Page is presented or may be presented soon */
+static int pageInFlight(int page)
+{
+  /* in pipeline mode published page may lag behind one given to setvisualpage */
+  return page == publishedPage
+    || page == BGI_FRAME_PAGE(ATOMIC_loadAcquire(&sharedStruct->latestFrame))
+    || page == sharedStruct->visualPage;
+}
+
+int getnextpage(void)
+{
+  int page, flushed = 0;
+  ICHECK_GRAPHCS_INITED
+  for(;;)
+  {
+    for(page = 0; page != pageCount; page++)
+      if(!pageInFlight(page))
+        return page;
+    /* all pages are busy: wait until presenter takes latest frame */
+    if(pipeline)
+      RENDER_wait(frameFence);
+    if(sharedStruct->presentMode == PRESENT_MANUAL && !flushed)
+    {
+      /* nobody takes frames in this mode except flushgraph */
+      flushgraph();
+      flushed = 1;
+    }
+    else
+    {
+      delay(0);
+    }
+  }
+}
+
+int lockpage(int page, g_pagedesctype * desc)
+{
+  int y, stride;
+  ICHECK_GRAPHCS_INITED
+  if(page < 0 || page >= pageCount)
+    return 0;
+  stride = RASTER_stride(windowWidth, pageBpp);
+  if(pageRows[page] == NULL)
+  {
+    pageRows[page] = BGI_malloc(windowHeight * sizeof(unsigned char *));
+    if(pageRows[page] == NULL)
+      return 0;
+    /* pages are bottom-up */
+    for(y = 0; y != windowHeight; y++)
+      pageRows[page][y] = (unsigned char *)pages[page].bits + (windowHeight - y - 1) * stride;
+  }
+  beginRaster();
+  /* render thread may still draw on page */
+  target->finish();
+  desc->bits = pages[page].bits;
+  desc->width = windowWidth;
+  desc->height = windowHeight;
+  desc->format = pageBpp;
+  desc->stride = stride;
+  desc->bottomup = 1;
+  desc->rows = pageRows[page];
+  return 1;
+}
+
+void unlockpage(int page, const g_recttype * damaged)
+{
+  int left = 0, top = 0, right = windowWidth - 1, bottom = windowHeight - 1;
+  CHECK_GRAPHCS_INITED
+  if(page < 0 || page >= pageCount)
+    return;
+  if(damaged != NULL)
+  {
+    left = damaged->left > left ? damaged->left : left;
+    top = damaged->top > top ? damaged->top : top;
+    right = damaged->right < right ? damaged->right : right;
+    bottom = damaged->bottom < bottom ? damaged->bottom : bottom;
+  }
+  if(left <= right && top <= bottom)
+    reportPageDamage(page, left, top, right + 1, bottom + 1);
+  endPageDraw(page);
+}
+
+unsigned getpresentfence(void)
+{
+  if(graphMode == -1)
+    return 0;
+  return BGI_FRAME_SEQUENCE(ATOMIC_loadAcquire(&sharedStruct->shownFrame));
+}
+
+unsigned getcontrolfence(void)
+{
+  if(graphMode == -1)
+    return 0;
+  /* only this thread posts messages, so head is not changed by others */
+  return sharedStruct->control.head;
+}
+
+void waitcontrol(unsigned fence)
+{
+  CHECK_GRAPHCS_INITED
+  BGI_waitControl(fence);
+}
+
 int rgb(int r, int g, int b)
 {
+    /* high color pages keep 5 bits of red and blue and 6 bits of green */
+    if(pageBpp == 16)
+        return ((b & 0xF8) >> 3) | ((g & 0xFC) << 3) | ((r & 0xF8) << 8);
     return (b & 0xFF) | ((g & 0xFF) << 8) | ((r & 0xFF) << 16);
 }
 
@@ -62,9 +62,41 @@ extern "C" {
 #define MOUSE_RIGHTBUTTON  2
 #define MOUSE_MIDDLEBUTTON 4
 
+/* getevent event types */
+#define EVENT_KEY        1
+#define EVENT_MOUSEMOVE  2
+#define EVENT_MOUSEDOWN  3
+#define EVENT_MOUSEUP    4
+
+/* setpresentmode modes */
+#define PRESENT_IMMEDIATE 0
+#define PRESENT_COALESCED 1
+#define PRESENT_MANUAL    2
+/* Frame clock rate that is used if setpresentmode is given rate <= 0 */
+#define PRESENT_DEFAULT_RATE 60
+/* Higher rates are lowered to it, clock ticks are whole milliseconds */
+#define PRESENT_MAX_RATE 1000
+
+/* startcapture file formats */
+#define CAPTURE_RAW   0
+#define CAPTURE_Y4M   1
+#define CAPTURE_DELTA 2
+
+/* lockpage pixel formats */
+#define PIXELFORMAT_4BPP  4
+#define PIXELFORMAT_8BPP  8
+#define PIXELFORMAT_16BPP 16
+#define PIXELFORMAT_32BPP 32
+
+/* setfillrule rules */
+#define FILLRULE_EVENODD 0
+#define FILLRULE_NONZERO 1
+
 #define CUSTOM_MODE(WIDTH, HEIGHT) ((WIDTH & 0xFFFF) | ((HEIGHT & 0xFFFF) << 16))
 
 #define MAXCOLORS 16
+/* Colors of "COLORS256" mode of initgraph */
+#define MAXCOLORS256 256
 
 enum graphics_drivers {
   DETECT,
@@ -210,9 +242,71 @@ typedef struct mousestate {
   int buttons;
 } g_mousestate;
 
+typedef struct eventtype {
+  int type;
+  /* time in milliseconds when event happened */
+  unsigned time;
+  /* EVENT_KEY: code of special key (KEY_UP, KEY_F1, ...) or 0 */
+  int key;
+  /* EVENT_KEY: typed character if key is 0 */
+  int letter;
+  /* mouse position and buttons state at the moment of event */
+  int x, y;
+  int buttons;
+} g_event;
+
+/* Counters of copies from visual page to window, see getpresentstats */
+typedef struct presentstats {
+  /* frames shown (setvisualpage calls, except frames replaced before present) */
+  unsigned frames;
+  /* window updates that copied something */
+  unsigned presents;
+  /* rectangles copied */
+  unsigned rects;
+  /* bytes of pages copied in all */
+  double bytes;
+  /* bytes copied between last two frames shown */
+  unsigned lastframebytes;
+} g_presentstats;
+
+/* Counters of frame capture, see getcapturestats */
+typedef struct capturestats {
+  /* frames written to file */
+  unsigned frames;
+  /* frames that were dropped since writer was behind */
+  unsigned dropped;
+  /* size of file */
+  double bytes;
+} g_capturestats;
+
+typedef struct recttype {
+  int left, top, right, bottom;
+} g_recttype;
+
+/* Memory of page given by lockpage */
+typedef struct pagedesctype {
+  /* first byte of page memory */
+  void * bits;
+  int width, height;
+  /**
+   * PIXELFORMAT_4BPP  - two colors per byte, left pixel in high nibble
+   * PIXELFORMAT_8BPP  - one color (index of palette) per byte
+   * PIXELFORMAT_16BPP - pixel is unsigned short RGB565 (red in high bits)
+   * PIXELFORMAT_32BPP - pixel is unsigned 0x00RRGGBB
+   */
+  int format;
+  /* bytes from row to row in memory, rows are aligned to 4 bytes */
+  int stride;
+  /* 1 if the bottom row is the first in memory */
+  int bottomup;
+  /* rows[y] is the first byte of row y, y = 0 is the top row */
+  unsigned char ** rows;
+} g_pagedesctype;
+
+/* size is MAXCOLORS, or MAXCOLORS256 in "COLORS256" mode */
 typedef struct palettetype{
-  unsigned char size;
-  colortype colors[MAXCOLORS+1];
+  int size;
+  colortype colors[MAXCOLORS256];
 } g_palettetype;
 
 typedef struct linesettingstype{
@@ -331,6 +425,97 @@ extern int keypressed(int key);
 extern int anykeypressed();
 extern int getfps();
 extern void getmousestate(g_mousestate * state);
+/* Takes next event from input queue, returns 0 if queue is empty */
+extern int getevent(g_event * event);
+/**
+ * When drawing is copied to window:
+ * PRESENT_IMMEDIATE - after every primitive on visual page (default)
+ * PRESENT_COALESCED - by server frame clock at most rate times per second,
+ *                     nothing is copied on ticks when nothing changed
+ * PRESENT_MANUAL    - only by flushgraph()
+ * setvisualpage() only selects page to present in last two modes.
+ */
+extern void setpresentmode(int mode, int rate);
+/* Presents what is drawn right now whatever present mode is */
+extern void flushgraph(void);
+/* Only damaged parts of page are copied to window, counters show how much */
+extern void getpresentstats(g_presentstats * stats);
+/* Highest page number, pages are counted by "PAGES=n" option of initgraph */
+extern int getmaxpage(void);
+/**
+ * Returns page that next frame may be drawn on: it is neither presented
+ * nor waiting to be presented, so drawing does not stall on present or
+ * tear visible frame. With two pages it waits until last frame given
+ * to setvisualpage is shown, with more pages client runs ahead.
+ */
+extern int getnextpage(void);
+/**
+ * Starts writing every frame given to setvisualpage to file:
+ * CAPTURE_RAW   - 24-bit RGB frames, rows from top to bottom
+ * CAPTURE_Y4M   - YUV4MPEG2 4:4:4 video (ffmpeg and players read it)
+ * CAPTURE_DELTA - only pixels changed from previous frame, format is
+ *                 described in Capture.h
+ * Frames are written by background thread, if it is behind frames are
+ * dropped instead of waiting for disk. Returns 0 if file can not be created.
+ */
+extern int startcapture(const char * path, int format);
+/* Writes frames that are queued and closes file */
+extern void stopcapture(void);
+extern void getcapturestats(g_capturestats * stats);
+/**
+ * Selects points of self-intersecting polygons that fillpoly fills:
+ * FILLRULE_EVENODD (default) - crossed by odd number of edges
+ * FILLRULE_NONZERO           - edges around them wind nonzero times
+ */
+extern void setfillrule(int rule);
+extern int getfillrule(void);
+/**
+ * Sprites are images of getimage compiled for fast drawing: pixels of
+ * colorkey are transparent, others are stored in pixel format of pages
+ * as runs, so drawsprite copies runs and skips transparent pixels.
+ * Sprite is compiled for current mode and is not drawn after initgraph
+ * with other color mode. createsprite returns NULL if there is no memory.
+ */
+extern void * createsprite(const void * bitmap, int colorkey);
+extern void drawsprite(int left, int top, const void * sprite);
+extern void freesprite(void * sprite);
+/**
+ * Gives direct access to page memory: everything drawn on page before
+ * is there when lockpage returns, pixels may be read and written until
+ * unlockpage, other drawing on page must wait for unlockpage. Returns 0
+ * if there is no such page.
+ * unlockpage reports damaged rectangle (inclusive, page coordinates) for
+ * present, NULL means whole page.
+ */
+extern int lockpage(int page, g_pagedesctype * desc);
+extern void unlockpage(int page, const g_recttype * damaged);
+/**
+ * Draw count primitives given as packed array of ints, every primitive
+ * ends with its color. It replaces drawing color (fill color for bars
+ * and fillellipses) for this primitive only, other settings are current:
+ * putpixels    - x, y, color
+ * drawlines    - x1, y1, x2, y2, color (line style and write mode)
+ * bars         - left, top, right, bottom, color (fill pattern)
+ * circles      - x, y, radius, color (line thickness)
+ * fillellipses - x, y, xradius, yradius, color (fill pattern, outline
+ *                is drawn with drawing color)
+ * Whole array is one damaged rectangle and one present, current
+ * position is not moved.
+ */
+extern void putpixels(int count, const int * pixels);
+extern void drawlines(int count, const int * lines);
+extern void bars(int count, const int * bars);
+extern void circles(int count, const int * circles);
+extern void fillellipses(int count, const int * ellipses);
+/* Number of frames shown so far (including one of initgraph), grows when presenter takes newer frame */
+extern unsigned getpresentfence(void);
+/**
+ * Palette and present mode changes are posted to server without waiting.
+ * getcontrolfence() returns fence of last change, waitcontrol(fence)
+ * blocks until server has applied changes up to it.
+ */
+extern unsigned getcontrolfence(void);
+extern void waitcontrol(unsigned fence);
 extern void setmousepos(int x, int y);
 extern int rgb(int r, int g, int b);
 
@@ -0,0 +1,117 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Windowed check of page formats: pages of "COLORS256" and "HICOLOR"
+ * modes must be created by server as 8bpp and 16bpp ones (lockpage
+ * tells format) and window must show colors of pages: colors of
+ * palette (also after palette is changed) and RGB565 pixels widened to
+ * 8 bits per component. Window pixels are read back from screen, so
+ * window must not be covered.
+ */
+
+#include <graphics.h>
+#include <windows.h>
+#include <assert.h>
+
+#define BARS 8
+
+/* Color that window shows at (x, y) */
+static COLORREF windowPixel(int x, int y)
+{
+  HWND wnd = FindWindow("BGI_SERVER", NULL);
+  HDC dc = GetDC(wnd);
+  COLORREF color = GetPixel(dc, x, y);
+  ReleaseDC(wnd, dc);
+  return color;
+}
+
+/* Middle of bar i */
+#define BAR_X(I) ((I) * (getmaxx() + 1) / BARS + 10)
+#define BAR_Y 10
+
+static void colors256(void)
+{
+  int gd = DETECT, gm, i;
+  g_pagedesctype page;
+  initgraph(&gd, &gm, "COLORS256");
+  lockpage(0, &page);
+  assert(page.format == PIXELFORMAT_8BPP);
+  unlockpage(0, NULL);
+  /* colors above 16 are the ones 4bpp pages do not have */
+  for(i = 0; i != BARS; i++)
+  {
+    setrgbpalette(100 + i, i * 30, 255 - i * 30, 128);
+    setfillstyle(SOLID_FILL, 100 + i);
+    bar(i * (getmaxx() + 1) / BARS, 0, (i + 1) * (getmaxx() + 1) / BARS - 1, getmaxy());
+  }
+  Sleep(200);
+  for(i = 0; i != BARS; i++)
+  {
+    assert(getpixel(BAR_X(i), BAR_Y) == (unsigned)(100 + i));
+    assert(windowPixel(BAR_X(i), BAR_Y) == RGB(i * 30, 255 - i * 30, 128));
+  }
+  /* palette is applied when page is presented, pixels are not redrawn */
+  for(i = 0; i != BARS; i++)
+    setrgbpalette(100 + i, 128, i * 30, 255 - i * 30);
+  /* server has taken new colors, window shows them after next present */
+  waitcontrol(getcontrolfence());
+  Sleep(200);
+  for(i = 0; i != BARS; i++)
+    assert(windowPixel(BAR_X(i), BAR_Y) == RGB(128, i * 30, 255 - i * 30));
+  closegraph();
+}
+
+/* Top bits of RGB565 components are repeated in low ones when page is presented */
+static COLORREF widened(unsigned pixel)
+{
+  int r = pixel >> 11, g = (pixel >> 5) & 0x3F, b = pixel & 0x1F;
+  return RGB(r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2);
+}
+
+static void hicolor(void)
+{
+  int gd = DETECT, gm, i;
+  unsigned pixel;
+  g_pagedesctype page;
+  initgraph(&gd, &gm, "HICOLOR");
+  lockpage(0, &page);
+  assert(page.format == PIXELFORMAT_16BPP);
+  unlockpage(0, NULL);
+  for(i = 0; i != BARS; i++)
+  {
+    setfillstyle(SOLID_FILL, rgb(i * 30, 255 - i * 30, 128));
+    bar(i * (getmaxx() + 1) / BARS, 0, (i + 1) * (getmaxx() + 1) / BARS - 1, getmaxy());
+  }
+  Sleep(200);
+  for(i = 0; i != BARS; i++)
+  {
+    pixel = getpixel(BAR_X(i), BAR_Y);
+    assert(pixel == (unsigned)rgb(i * 30, 255 - i * 30, 128));
+    assert(windowPixel(BAR_X(i), BAR_Y) == widened(pixel));
+  }
+  closegraph();
+}
+
+int main(void)
+{
+  colors256();
+  hicolor();
+  return 0;
+}
@@ -100,10 +100,14 @@ void drawParticles(PARTICLE * ps) {
   int i;
   int w = getmaxx() / 2;
   int h = getmaxy() / 2;
+  int circleArray[PARTICLE_NUMBER * 4]; // x, y, radius, color of every particle
   for(i = 0; i != PARTICLE_NUMBER; i++) {
-    setcolor((i % getmaxcolor()) + 1);
-    circle(w + ps[i].position.x + orgX, h - ps[i].position.y - orgY, PARTICLE_RADIUS);
+    circleArray[i * 4] = (int)(w + ps[i].position.x + orgX);
+    circleArray[i * 4 + 1] = (int)(h - ps[i].position.y - orgY);
+    circleArray[i * 4 + 2] = PARTICLE_RADIUS;
+    circleArray[i * 4 + 3] = (i % getmaxcolor()) + 1;
   }
+  circles(PARTICLE_NUMBER, circleArray);
 }
 
 int intersectsAny(PARTICLE * p, int n) {
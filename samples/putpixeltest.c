@@ -1,16 +1,25 @@
 #include <graphics.h>
 #include <assert.h>
 
+/* Bar is written to page memory, it is called in RGB mode only */
 void mybar(int x, int y, int w, int h, int c)
 {
     int i, j;
+    g_pagedesctype page;
+    g_recttype changed;
+    lockpage(0, &page);
     for(i = y; i <= y + h; i++) 
     {
         for(j = x; j <= x + h; j++)
         {
-            putpixel(j, i, c);
+            ((unsigned *)page.rows[i])[j] = c;
         }
     }
+    changed.left = x;
+    changed.top = y;
+    changed.right = x + h;
+    changed.bottom = y + h;
+    unlockpage(0, &changed);
 }
 
 int main() 
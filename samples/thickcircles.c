@@ -0,0 +1,68 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Outlines of circles and arcs follow line thickness: with THICK_WIDTH
+ * they are three pixels across, like lines are, and have no holes.
+ */
+
+#include <graphics.h>
+#include <assert.h>
+
+#define X 100
+#define Y 100
+#define R 40
+
+/* Set pixels in box around circle */
+static int setPixels(void)
+{
+  int x, y, count = 0;
+  for(y = Y - R - 2; y <= Y + R + 2; y++)
+    for(x = X - R - 2; x <= X + R + 2; x++)
+      count += getpixel(x, y) != BLACK;
+  return count;
+}
+
+int main(void)
+{
+  int gd = DETECT, gm, thin, thick, dy;
+  initgraph(&gd, &gm, "");
+  circle(X, Y, R);
+  thin = setPixels();
+  cleardevice();
+  setlinestyle(SOLID_LINE, 0, THICK_WIDTH);
+  circle(X, Y, R);
+  thick = setPixels();
+  /* three pixels across, a few more where outline turns across 45 degrees */
+  assert(thick >= 3 * thin && thick <= 3 * thin + thin / 4);
+  /* outline is widened along x on the left and right, along y at the top and bottom */
+  for(dy = -1; dy <= 1; dy++)
+  {
+    assert(getpixel(X + R + dy, Y) != BLACK);
+    assert(getpixel(X, Y - R + dy) != BLACK);
+  }
+  assert(getpixel(X + R + 2, Y) == BLACK);
+  cleardevice();
+  arc(X, Y, 0, 90, R);
+  assert(getpixel(X + R - 1, Y) != BLACK && getpixel(X, Y - R - 1) != BLACK);
+  outtextxy(0, 0, "thick circles are fine");
+  readkey();
+  closegraph();
+  return 0;
+}
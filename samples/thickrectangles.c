@@ -0,0 +1,74 @@
+/*
+  BGI library implementation for Microsoft(R) Windows(TM)
+  Copyright (C) 2006  Daniil Guitelson
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Thick rectangles are bands three pixels across with full corners, and
+ * every pixel is drawn once: XOR_PUT does not erase pixels where sides
+ * meet, and the same rectangle drawn again erases it completely.
+ */
+
+#include <graphics.h>
+#include <assert.h>
+
+#define LEFT 50
+#define TOP 50
+#define RIGHT 100
+#define BOTTOM 100
+
+/* Set pixels in box around rectangle */
+static int setPixels(void)
+{
+  int x, y, count = 0;
+  for(y = TOP - 3; y <= BOTTOM + 3; y++)
+    for(x = LEFT - 3; x <= RIGHT + 3; x++)
+      count += getpixel(x, y) != BLACK;
+  return count;
+}
+
+/* Pixels of band from (LEFT - 1, TOP - 1) to (RIGHT + 1, BOTTOM + 1) */
+#define BAND_PIXELS ((RIGHT - LEFT + 3) * (BOTTOM - TOP + 3) - (RIGHT - LEFT - 3) * (BOTTOM - TOP - 3))
+
+int main(void)
+{
+  int gd = DETECT, gm;
+  initgraph(&gd, &gm, "");
+  setlinestyle(SOLID_LINE, 0, THICK_WIDTH);
+  rectangle(LEFT, TOP, RIGHT, BOTTOM);
+  assert(setPixels() == BAND_PIXELS);
+  /* outer corner */
+  assert(getpixel(LEFT - 1, TOP - 1) != BLACK && getpixel(LEFT - 1, TOP) != BLACK);
+  assert(getpixel(RIGHT + 1, BOTTOM + 1) != BLACK);
+  assert(getpixel(LEFT + 2, TOP + 2) == BLACK);
+  cleardevice();
+  setwritemode(XOR_PUT);
+  rectangle(LEFT, TOP, RIGHT, BOTTOM);
+  assert(setPixels() == BAND_PIXELS);
+  assert(getpixel(LEFT, TOP + 1) != BLACK && getpixel(LEFT + 1, TOP + 1) != BLACK);
+  rectangle(LEFT, TOP, RIGHT, BOTTOM);
+  assert(setPixels() == 0);
+  /* flat rectangle is one band */
+  rectangle(LEFT, TOP, RIGHT, TOP + 1);
+  assert(setPixels() == (RIGHT - LEFT + 3) * 4);
+  rectangle(LEFT, TOP, RIGHT, TOP + 1);
+  setwritemode(COPY_PUT);
+  outtextxy(0, 0, "thick rectangles are fine");
+  readkey();
+  closegraph();
+  return 0;
+}